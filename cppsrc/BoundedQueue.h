@@ -0,0 +1,60 @@
+#ifndef BOUNDED_QUEUE_H_
+#define BOUNDED_QUEUE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+template <class T> class BoundedQueue
+{
+    /*
+        Links two stages of a pipeline: producers block in push() while the queue is full, so a fast stage cannot get
+        ahead of a slow one by more than capacity items. Consumers pop() until the producers close() the queue.
+    */
+    public:
+    BoundedQueue(size_t capacity);
+    void push(T item);
+    bool pop(T& item);    // false once the queue is closed and empty
+    void close(void);
+
+    private:
+    std::deque<T>           m_items;
+    size_t                  m_capacity;
+    bool                    m_closed;
+    std::mutex              m_lock;
+    std::condition_variable m_not_full, m_not_empty;
+};
+
+template <class T> BoundedQueue<T>::BoundedQueue(size_t capacity) : m_capacity(capacity ? capacity : 1), m_closed(false) {}
+
+template <class T> void BoundedQueue<T>::push(T item)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_not_full.wait(lock, [this]() { return m_items.size() < m_capacity; });
+    m_items.push_back(std::move(item));
+    lock.unlock();
+    m_not_empty.notify_one();
+}
+
+template <class T> bool BoundedQueue<T>::pop(T& item)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_not_empty.wait(lock, [this]() { return !m_items.empty() or m_closed; });
+    if (m_items.empty()) return false;
+    item = std::move(m_items.front());
+    m_items.pop_front();
+    lock.unlock();
+    m_not_full.notify_one();
+    return true;
+}
+
+template <class T> void BoundedQueue<T>::close(void)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_closed = true;
+    lock.unlock();
+    m_not_empty.notify_all();
+}
+
+#endif    // BOUNDED_QUEUE_H_
@@ -0,0 +1,57 @@
+#include "GappedPattern.h"
+
+using namespace std;
+
+
+// Nucleotide classes: A, C, G, U, and anything else (only matched by wildcards)
+static const uint8_t n_classes = 5;
+
+static inline uint8_t nt_class(char c)
+{
+    switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'U': return 3;
+    default: return 4;
+    }
+}
+
+GappedPattern::GappedPattern(void) : window_(0) {}
+
+GappedPattern::GappedPattern(const string& pattern) : window_(0)
+{
+    segments_.push_back(Segment());
+    segments_.back().length = 0;
+    segment_patterns_.push_back("");
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] == '.' and i + 1 < pattern.size() and pattern[i + 1] == '{') {
+            // a gap '.{n,}': close the current segment and start a new one
+            size_t close = pattern.find('}', i);
+            min_gaps_.push_back(stoul(pattern.substr(i + 2, pattern.find(',', i) - i - 2)));
+            segments_.push_back(Segment());
+            segments_.back().length = 0;
+            segment_patterns_.push_back("");
+            i = close;
+            continue;
+        }
+        if (pattern[i] == '~') {
+            // '~n': the segment is extended to a window of n nucleotides
+            window_ = stoul(pattern.substr(i + 1));
+            break;
+        }
+        uint8_t allowed = (pattern[i] == '.') ? (1 << n_classes) - 1 : (nt_class(pattern[i]) < 4 ? 1 << nt_class(pattern[i]) : 0);
+        segments_.back().allowed.push_back(allowed);
+        segments_.back().length++;
+        segment_patterns_.back() += pattern[i];
+    }
+}
+
+bool GappedPattern::matches_at(const string& rna, size_t pos) const
+{
+    const Segment& s = segments_[0];
+    if (pos + s.length > rna.size()) return false;
+    for (size_t i = 0; i < s.length; i++)
+        if (!(s.allowed[i] & (1 << nt_class(rna[pos + i])))) return false;
+    return true;
+}
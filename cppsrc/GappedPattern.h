@@ -0,0 +1,48 @@
+#ifndef GAPPED_PATTERN_H_
+#define GAPPED_PATTERN_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+class GappedPattern
+{
+    /*
+        The patterns used to place DESC and RIN motifs: literal nucleotides (A, C, G, U), '.' wildcards,
+        and '.{n,}' gaps of at least n nucleotides between fixed-length segments.
+        A single segment may end with '~n': it is then placed as a window of n nucleotides containing it anywhere,
+        e.g. 'G~3' stands for 'G..', '.G.' and '..G' at once.
+        MotifScanner finds the candidate positions of the first segment, GappedPattern checks them (matches_at()).
+        The other segments only describe whole DESC patterns, which are checked segment by segment (is_desc_insertible()).
+    */
+    public:
+    GappedPattern(void);
+    GappedPattern(const string& pattern);
+    size_t length(void) const;                                  // length of a match of the first segment
+    size_t window(void) const;                                  // length of the window around a match, with '~n'
+    bool   matches_at(const string& rna, size_t pos) const;     // wether the first segment matches rna at pos
+    const vector<string>& get_segments(void) const;
+    const vector<size_t>& get_min_gaps(void) const;
+
+    private:
+    typedef struct {
+        size_t          length;
+        vector<uint8_t> allowed;     // bit c of allowed[i] is set iff nucleotide class c is allowed at position i
+    } Segment;
+
+    vector<Segment> segments_;            // fixed-length parts of the pattern
+    vector<string>  segment_patterns_;    // the same parts, as written in the pattern
+    vector<size_t>  min_gaps_;            // min_gaps_[i] is the minimal number of nucleotides between segments i and i+1
+    size_t          window_;              // n of a trailing '~n', 0 if none
+};
+
+inline size_t GappedPattern::length(void) const { return segments_.size() ? segments_[0].length : 0; }
+inline size_t GappedPattern::window(void) const { return window_ > length() ? window_ : length(); }
+inline const vector<string>& GappedPattern::get_segments(void) const { return segment_patterns_; }
+inline const vector<size_t>& GappedPattern::get_min_gaps(void) const { return min_gaps_; }
+
+#endif    // GAPPED_PATTERN_H_
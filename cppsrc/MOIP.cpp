@@ -2,18 +2,28 @@
 #include "Pool.h"
 #include "Motif.h"
 #include <algorithm>
+#include <atomic>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
 #include <cfloat>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <limits>
-#include <regex>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -24,18 +34,16 @@ char   MOIP::obj_function_nbr_ = 'A';
 uint   MOIP::obj_to_solve_     = 1;
 double MOIP::precision_        = 1e-5;
 bool   MOIP::allow_pk_         = true;
+char   MOIP::pk_formulation_   = 'A';
 uint   MOIP::max_sol_nbr_      = 500;
-
-
-struct recursive_directory_range {
-    typedef recursive_directory_iterator iterator;
-    recursive_directory_range(path p) : p_(p) {}
-
-    iterator begin() { return recursive_directory_iterator(p_); }
-    iterator end() { return recursive_directory_iterator(); }
-
-    path p_;
-};
+string MOIP::export_model_     = "";
+uint   MOIP::n_solvers_        = 1;
+uint   MOIP::n_jobs_           = 1;
+double MOIP::time_limit_       = 0;
+double MOIP::solve_time_limit_ = 0;
+string MOIP::checkpoint_dir_   = "";
+double MOIP::checkpoint_interval_ = 600;
+bool   MOIP::resume_           = false;
 
 
 unsigned getNumConstraints(IloModel& m)
@@ -53,46 +61,20 @@ MOIP::MOIP() {}
 
 
 
-MOIP::MOIP(const RNA& rna, string source, string source_path, float theta, bool verbose) : verbose_{verbose}, rna_(rna) 
+MOIP::MOIP(shared_ptr<const RNA> rna, string source, string source_path, float theta, bool verbose)
+: verbose_{verbose}, obj_function_{obj_function_nbr_}, rna_(rna)
 {
-    if (!exists(source_path))
-    {
-        cerr << "!!! Hmh, i can't find that folder: " << source_path << endl;
-        exit(EXIT_FAILURE);
-    }
-
-    if (verbose_) cout << "Summary of basepair probabilities:" << endl;
-    if (verbose_) rna_.print_basepair_p_matrix(theta);
-
-    if (verbose_) cout << "Defining problem decision variables..." << endl;
-    basepair_dv_  = IloNumVarArray(env_);
-    insertion_dv_ = IloNumVarArray(env_);
-
-    // Add the y^u_v decision variables
-    if (verbose_) cout << "\t> Legal basepairs : ";
-    uint u, v, c = 0;
-    index_of_yuv_ = vector<vector<size_t>>(rna_.get_RNA_length() - 6, vector<size_t>(0));
-    for (u = 0; u < rna_.get_RNA_length() - 6; u++)
-        for (v = u + 4; v < rna_.get_RNA_length(); v++)    // A basepair is possible iff v > u+3
-            if (rna_.get_pij(u, v) > theta) {
-                if (verbose_) cout << u << '-' << v << " ";
-                index_of_yuv_[u].push_back(c);
-                c++;
-                char name[15];
-                sprintf(name, "y%d,%d", u, v);
-                basepair_dv_.add(IloNumVar(env_, 0, 1, IloNumVar::Bool, name));    // A boolean whether u and v are paired
-            } else {
-                index_of_yuv_[u].push_back(rna_.get_RNA_length() * rna_.get_RNA_length() + 1);
-            }
-    if (verbose_) cout << endl;
-
-    // Look for insertions sites, then create the appropriate Cxip variables
-    insertion_sites_ = vector<Motif>();
+    if (!exists(source_path)) throw runtime_error("!!! Hmh, i can't find that folder: " + source_path);
 
-    if (verbose_) cout << "\t> Looking for insertion sites..." << endl;
+    define_basepair_variables(theta);
 
     if (source == "jar3dcsv" or source == "bayespaircsv")
     {
+        // Look for insertions sites in the CSV file
+        insertion_sites_ = vector<Motif>();
+
+        if (verbose_) cout << "\t> Looking for insertion sites..." << endl;
+
         std::ifstream motifs;
         string        line;
 
@@ -123,112 +105,134 @@ MOIP::MOIP(const RNA& rna, string source, string source_path, float theta, bool
             insertion_sites_.push_back(this_motif);
         }
     }
-    else if (source == "descfolder") 
-    {
-        mutex         posInsertionSites_access;
-        Pool          pool;
-        int           errors   = 0;
-        int           accepted = 0;
-        int           inserted = 0;
-        int           num_threads = thread::hardware_concurrency() - 1;
-        vector<thread> thread_pool;
-
-        for (int i = 0; i < num_threads; i++) 
-            thread_pool.push_back(thread(&Pool::infinite_loop_func, &pool));
-
-        // Read every .desc file and add it to the queue (iff valid)
-        char error;
-        for (auto it : recursive_directory_range(source_path))
-        {    
-            
-            if ((error = Motif::is_valid_DESC(it.path().string()))) // Returns error if DESC file is incorrect
-            {
-                if (verbose)
-                {
-                    cerr << "\t>Ignoring motif " << it.path().stem();
-                    switch (error)
-                    {
-                        case '-': cerr << ", some nucleotides have a negative number..."; break;
-                        case 'l': cerr << ", hairpin (terminal) loops must be at least of size 3 !"; break;
-                        case 'b': cerr << ", backbone link between non-consecutive residues ?"; break;
-                        default:  cerr << ", use of an unknown nucleotide " << error;
-                    }
-                    cerr << endl;
-                }
-                errors++;
-                continue;
-            }
-            accepted++;
-            if (is_desc_insertible(it.path().string(), rna_.get_seq()))
-            {
-                args_of_parallel_func args(it.path(), posInsertionSites_access);
-                inserted++;
-                pool.push(bind(&MOIP::allowed_motifs_from_desc, this, args)); // & is necessary to get the pointer to a member function
-            }
-        }
-        pool.done();
+    else
+        search_insertion_sites(MotifLibrary(source, source_path, verbose_), theta);
+
+    define_model(source);
+}
+
+MOIP::MOIP(shared_ptr<const RNA> rna, const MotifLibrary& library, float theta, bool verbose, char obj_function)
+: verbose_{verbose}, obj_function_{obj_function}, rna_(rna)
+{
+    define_basepair_variables(theta);
+    search_insertion_sites(library, theta);
+    define_model(library.get_source());
+}
+
+unique_ptr<MOIP> MOIP::replica(uint solver, uint cplex_threads) const
+{
+    // Another solver of the same problem: same variables and constraints, in its own CPLEX environment
+    unique_ptr<MOIP> r(new MOIP());
+    r->verbose_         = false;
+    r->job_             = job_;
+    r->solver_          = solver;
+    r->obj_function_    = obj_function_;
+    r->cplex_threads_   = cplex_threads;
+    r->start_           = start_;    // same deadline
+    r->rna_             = rna_;
+    r->insertion_sites_ = insertion_sites_;
+    r->define_basepair_variables(theta_);
+    r->define_model(source_);
+    return r;
+}
+
+void MOIP::define_basepair_variables(float theta)
+{
+    theta_ = theta;
+    if (verbose_) cout << "Summary of basepair probabilities:" << endl;
+    if (verbose_) rna_->print_basepair_p_matrix(theta);
 
-        for (unsigned int i = 0; i < thread_pool.size(); i++)
-            thread_pool.at(i).join();
+    if (verbose_) cout << "Defining problem decision variables..." << endl;
 
-        if (verbose){
-            cout << "\t> " << inserted << " candidate motifs on " << accepted + errors << " (" << errors << " ignored motifs), " << endl;
-            cout << "\t  " << insertion_sites_.size() << " insertion sites kept after applying probability threshold of " << theta << endl;
+    // Add the y^u_v decision variables
+    if (verbose_) cout << "\t> Legal basepairs : ";
+    uint n = rna_->get_RNA_length();
+    basepairs_.clear();
+    first_basepair_ = vector<uint>(n + 1, 0);
+    partners_       = vector<vector<uint>>(n);
+    for (const BasePairProb& bp : rna_->get_basepair_probabilities())    // sorted by (i,j)
+        if (bp.i + 6 < n and bp.j > bp.i + 3 and bp.p > theta) {    // A basepair is possible iff v > u+3
+            if (verbose_) cout << bp.i << '-' << bp.j << " ";
+            uint c = basepairs_.size();
+            basepairs_.push_back(make_pair(bp.i, bp.j));
+            first_basepair_[bp.i + 1]++;
+            partners_[bp.i].push_back(c);    // pairs (w,u), w<u, are all met before pairs (u,v), v>u, so every
+            partners_[bp.j].push_back(c);    // partners_[u] ends up sorted by partner
         }
-    }
-    else if (source == "rinfolder")
+    for (uint u = 0; u < n; u++) first_basepair_[u + 1] += first_basepair_[u];
+    if (verbose_) cout << endl;
+
+    // Banded lookup table of the candidates: ViennaRNA bounds the span of the pairs, so n * max_span_ entries are enough
+    max_span_ = 0;
+    for (const pair<uint, uint>& bp : basepairs_) max_span_ = max(max_span_, bp.second - bp.first);
+    basepair_band_ = vector<uint>(size_t(n) * max_span_, basepairs_.size());
+    for (size_t c = 0; c < basepairs_.size(); c++)
+        basepair_band_[size_t(basepairs_[c].first) * max_span_ + basepairs_[c].second - basepairs_[c].first - 1] = c;
+
+    // A boolean whether u and v are paired, for every candidate. Names are only needed to read the model.
+    basepair_dv_ = IloNumVarArray(env_, basepairs_.size(), 0, 1, IloNumVar::Bool);
+    if (verbose_ or !export_model_.empty())
+        for (size_t c = 0; c < basepairs_.size(); c++) {
+            char name[24];
+            sprintf(name, "y%u,%u", basepairs_[c].first, basepairs_[c].second);
+            basepair_dv_[c].setName(name);
+        }
+}
+
+void MOIP::search_insertion_sites(const MotifLibrary& library, float theta)
+{
+    // Look for insertions sites of the motifs of the library, then create the appropriate Cxip variables
+    insertion_sites_ = vector<Motif>();
+
+    if (verbose_) cout << "\t> Looking for insertion sites..." << endl;
+
+    vector<vector<Motif>> sites(library.size());    // insertion sites of every motif, filled by its own task
+    atomic<size_t>        inserted(0);
+
+    // Find all the component patterns of the library in a single pass over the sequence (and the reversed sequence for RINs)
+    string        reversed_rna = rna_->get_seq();
+    ComponentHits hits         = library.scan(rna_->get_seq());
+    ComponentHits reversed_hits;
+    if (library.get_source() == "rinfolder")
     {
-        mutex         posInsertionSites_access;
-        Pool          pool;
-        size_t        inserted = 0;
-        size_t        accepted = 0;
-        size_t        errors   = 0;
-        int           num_threads = thread::hardware_concurrency() - 1;
-        vector<thread> thread_pool;
-
-        for (int i = 0; i < num_threads; i++) 
-            thread_pool.push_back(thread(&Pool::infinite_loop_func, &pool));
-
-        // Read every RIN file and add it to the queue (iff valid)
-		char error;
-        for (auto it : recursive_directory_range(source_path))
+        std::reverse(reversed_rna.begin(), reversed_rna.end());
+        reversed_hits = library.scan(reversed_rna);
+    }
+
+    // Place every motif of the library, in parallel
+    auto place_motif = [&](size_t t) {
+        args_of_parallel_func args(library[t], hits, reversed_hits, sites[t]);
+        if (library.get_source() == "descfolder")
         {
-			if ((error = Motif::is_valid_RIN(it.path().string()))) // Returns error if RIN file is incorrect
-			{
-				if (verbose)
-                {
-                    cerr << "\t>Ignoring RIN " << it.path().stem();
-                    switch (error)
-                    {
-                        case 'l': cerr << ", too short to be considered."; break;
-                        case 'x': cerr << ", because not constraining the secondary structure."; break;
-						default: cerr << ", unknown reason";
-                    }
-                    cerr << endl;
-                }
-				errors++;
-                continue;
-			}
-            accepted++;
-            args_of_parallel_func args(it.path(), posInsertionSites_access);
+            if (!is_desc_insertible(library[t], hits)) return;
             inserted++;
-            pool.push(bind(&MOIP::allowed_motifs_from_rin, this, args)); // & is necessary to get the pointer to a member function
+            allowed_motifs_from_desc(args);
         }
-        pool.done();
-
-        for (unsigned int i = 0; i < thread_pool.size(); i++)
-            thread_pool.at(i).join();
-
-        if (verbose){
-            cout << "\t> " << inserted << " candidate RINs on " << accepted + errors << " (" << errors << " ignored motifs), " << endl;
-            cout << "\t  " << insertion_sites_.size() << " insertion sites kept after applying probability threshold of " << theta << endl;
+        else
+        {
+            inserted++;
+            allowed_motifs_from_rin(args);
         }
+    };
+    Pool::shared().parallel_for(library.size(), place_motif);
+
+    // Merge in library order, then placement order, whatever the number of threads and their timing:
+    // the order of the Cxip variables, hence the behaviour of CPLEX, must not depend on them.
+    size_t n_sites = 0;
+    for (const vector<Motif>& s : sites) n_sites += s.size();
+    insertion_sites_.reserve(n_sites);
+    for (vector<Motif>& s : sites) insertion_sites_.insert(insertion_sites_.end(), make_move_iterator(s.begin()), make_move_iterator(s.end()));
+
+    if (verbose_){
+        cout << "\t> " << inserted.load() << " candidate motifs on " << library.size() + library.get_n_errors() << " (" << library.get_n_errors() << " ignored motifs), " << endl;
+        cout << "\t  " << insertion_sites_.size() << " insertion sites kept after applying probability threshold of " << theta << endl;
     }
-    else
-    {
-        cout << "!!! Problem with the source" << endl;
-    }
+}
 
+void MOIP::define_model(string source)
+{
+    auto build_start = chrono::steady_clock::now();
+    source_          = source;
     // Add the Cx,i,p decision variables
     if (verbose_) cout << "\t> Allowed candidate insertion sites:" << endl;
     index_of_first_components.reserve(insertion_sites_.size()); // to remember the place of first components in insertion_dv_
@@ -241,23 +245,24 @@ MOIP::MOIP(const RNA& rna, string source, string source_path, float theta, bool
         index_of_first_components.push_back(i);
         index_of_Cxip_.push_back(vector<size_t>(0)); // A vector of size 0 (empty)
 
-        for (const Component& cmp : m.comp) {
+        for (size_t j = 0; j < m.comp.size(); j++) {
             index_of_Cxip_.back().push_back(i); // Add i to the current module vector
             i++;
-            char name[20];
-            sprintf(
-                name,
-                "C%d,%d[%d,%d]",
-                static_cast<int>(index_of_Cxip_.size() - 1), // The number of motifs to date
-                static_cast<int>(index_of_Cxip_.back().size() - 1), // The number of components in the last motif to date
-                cmp.pos.first,
-                cmp.pos.second
-            );
-            insertion_dv_.add(IloNumVar(env_, 0, 1, IloNumVar::Bool, name));    // A boolean whether component i of motif x is inserted at position p, named 'name'
         }
     }
 
-    if (verbose_) cout << "\t> " << c << " + " << i << " (yuv + Cpxi) decision variables are used." << endl;
+    // A boolean whether component i of motif x is inserted at position p, named 'Cx,i[p]' if the model is to be read
+    insertion_dv_ = IloNumVarArray(env_, i, 0, 1, IloNumVar::Bool);
+    if (verbose_ or !export_model_.empty())
+        for (size_t x = 0; x < insertion_sites_.size(); x++)
+            for (size_t j = 0; j < insertion_sites_[x].comp.size(); j++) {
+                char name[48];
+                sprintf(name, "C%d,%d[%d,%d]", static_cast<int>(x), static_cast<int>(j),
+                        static_cast<int>(insertion_sites_[x].comp[j].pos.first), static_cast<int>(insertion_sites_[x].comp[j].pos.second));
+                insertion_dv_[index_of_Cxip_[x][j]].setName(name);
+            }
+
+    if (verbose_) cout << "\t> " << basepair_dv_.getSize() << " + " << i << " (yuv + Cpxi) decision variables are used." << endl;
 
     // Adding the problem's constraints
     model_ = IloModel(env_);
@@ -273,7 +278,7 @@ MOIP::MOIP(const RNA& rna, string source, string source_path, float theta, bool
     obj1 = IloExpr(env_);
     for (uint i = 0; i < insertion_sites_.size(); i++) {
         IloNum sum_k = 0;
-        switch (obj_function_nbr_) {
+        switch (obj_function_) {
         case 'A':
             // RNA MoIP style
             for (const Component& c : insertion_sites_[i].comp) sum_k += c.k;
@@ -303,76 +308,78 @@ MOIP::MOIP(const RNA& rna, string source, string source_path, float theta, bool
 
     // Define the expected accuracy objective function:
     obj2 = IloExpr(env_);
-    for (size_t u = 0; u < rna_.get_RNA_length() - 6; u++) {
-        for (size_t v = u + 4; v < rna_.get_RNA_length(); v++) {
-            if (allowed_basepair(u, v)) obj2 += (IloNum(rna_.get_pij(u, v)) * y(u, v));
-        }
-    }
+    for (const BasePairProb& bp : rna_->get_basepair_probabilities())
+        if (allowed_basepair(bp.i, bp.j)) obj2 += (IloNum(bp.p) * y(bp.i, bp.j));
+
+    // The objective and the bounds on both objectives stay in the model, solve_objective() only changes them
+    objective_nbr_ = 1;
+    objective_     = IloMaximize(env_, obj1);
+    bounds_[0]     = IloRange(env_, -IloInfinity, obj1, IloInfinity);
+    bounds_[1]     = IloRange(env_, -IloInfinity, obj2, IloInfinity);
+    model_.add(objective_);
+    model_.add(bounds_[0]);
+    model_.add(bounds_[1]);
+    all_dv_ = IloNumVarArray(env_);
+    all_dv_.add(basepair_dv_);
+    all_dv_.add(insertion_dv_);
+
+    if (verbose_)
+        cout << "Model built in " << chrono::duration<double>(chrono::steady_clock::now() - build_start).count()
+             << " s, its CPLEX environment uses " << env_.getMemoryUsage() / 1048576.0 << " MB." << endl;
 }
 
 MOIP::~MOIP() { env_.end(); }
 
 
 
-bool MOIP::is_undominated_yet(const SecondaryStructure& s)
-{
-    for (SecondaryStructure& x : pareto_) {
-        if (x > s) return false;
-    }
-    return true;
-}
-
 void MOIP::define_problem_constraints(string& source)
 {
 
     // ensure there only is 0 or 1 pairing by nucleotide:
     if (verbose_) cout << "\t> ensuring there are at most 1 pairing by nucleotide..." << endl;
-    uint u, v, count;
-    uint n = rna_.get_RNA_length();
+    uint u, v;
+    uint n = rna_->get_RNA_length();
     for (u = 0; u < n; u++) {
-        count = 0;
+        if (partners_[u].size() < 2) continue;
         IloExpr c1(env_);
-        for (v = 0; v < u; v++)
-            if (allowed_basepair(v, u)) {
-                c1 += y(v, u);
-                count++;
-            }
-        for (v = u + 4; v < n; v++)
-            if (allowed_basepair(u, v)) {
-                c1 += y(u, v);
-                count++;
-            }
-        if (count > 1) {
-            model_.add(c1 <= 1);
-            if (verbose_) cout << "\t\t" << (c1 <= 1) << endl;
-        }
+        for (uint c : partners_[u]) c1 += basepair_dv_[c];
+        model_.add(c1 <= 1);
+        if (verbose_) cout << "\t\t" << (c1 <= 1) << endl;
+        c1.end();
     }
 
     // forbid lonely basepairs if databases other than CaRNAval are being used
     if (source != "rinfolder")
     {
         if (verbose_) cout << "\t> forbidding lonely basepairs..." << endl;
-        for (u = 0; u < n - 5; u++)
-            for (v = u + 4; v < n; v++)
-            {
-                if (allowed_basepair(u, v))
-                {
-                    IloExpr c2(env_);
-                    c2 += -y(u, v);
-                    if (allowed_basepair(u - 1, v + 1)) c2 += y(u - 1, v + 1);
-                    if (allowed_basepair(u + 1, v - 1)) c2 += y(u + 1, v - 1);
-                    model_.add(c2 >= 0);
-                    if (verbose_) cout << "\t\t" << (c2 >= 0) << endl;
-                }
-            }
+        for (size_t c = 0; c < basepairs_.size(); c++)
+        {
+            u = basepairs_[c].first;
+            v = basepairs_[c].second;
+            IloExpr c2(env_);
+            c2 += -basepair_dv_[c];
+            if (u > 0 and allowed_basepair(u - 1, v + 1)) c2 += y(u - 1, v + 1);
+            if (allowed_basepair(u + 1, v - 1)) c2 += y(u + 1, v - 1);
+            model_.add(c2 >= 0);
+            if (verbose_) cout << "\t\t" << (c2 >= 0) << endl;
+            c2.end();
+        }
     }
 
     // Forbid pairings inside every motif component if included
     if (verbose_) cout << "\t> forbidding basepairs inside included motif's components..." << endl;
+    bool keep_links = (source == "rinfolder");    // the RIN's own basepairs are allowed inside its components
     for (size_t i = 0; i < insertion_sites_.size(); i++)
     {
         Motif& x = insertion_sites_[i];
 
+        unordered_set<uint> links;    // the candidate basepairs of the RIN, by index in basepairs_
+        if (keep_links)
+            for (const Link& link : x.links_) {
+                size_t a = x.nt_position(link.nts.first), b = x.nt_position(link.nts.second);
+                if (allowed_basepair(a, b)) links.insert(get_yuv_index(a, b));
+            }
+
         for (size_t j = 0; j < x.comp.size(); j++)
         {
             Component& c = x.comp[j];
@@ -381,34 +388,12 @@ void MOIP::define_problem_constraints(string& source)
             c3 += (kxi - IloNum(2)) * C(i, j);
             uint count = 0;
             for (u = c.pos.first + 1; u < c.pos.second; u++)
-                for (v = 0; v < n; v++)
-                {
-                    if (allowed_basepair(u,v))
+                for (uint bp : partners_[u])
+                    if (!links.count(bp))
                     {
-                        if (source != "rinfolder")
-                        {
-                            c3 += y(u, v);
-                            count++;
-                        }
-
-                        else
-                        {
-                            bool is_link = false;
-                            for (Link link : x.links_)
-                                if ((u==link.nts.first and v==link.nts.second) or (u==link.nts.second and v==link.nts.first))
-                                {
-                                    is_link = true;
-                                    break;
-                                }
-
-                            if (!is_link)
-                            {
-                                c3 += y(u, v);
-                                count++;
-                            }
-                        }
+                        c3 += basepair_dv_[bp];
+                        count++;
                     }
-                }
 
             if (count > 0)
             {
@@ -417,27 +402,43 @@ void MOIP::define_problem_constraints(string& source)
                 if (verbose_) cout << x.get_identifier() << '-' << j << ": ";
                 if (verbose_) cout << (c3 <= (kxi - IloNum(2))) << endl;
             }
+            c3.end();
         }
     }
     // Forbid component overlap
     if (verbose_) cout << "\t> forbidding component overlap..." << endl;
-    for (u = 0; u < n; u++) {
-        IloExpr c4(env_);
-        uint    nterms = 0;
-        for (size_t i = 0; i < insertion_sites_.size(); i++) {
-            Motif& x = insertion_sites_[i];
-            for (size_t j = 0; j < x.comp.size(); j++) {
-                Component& c = x.comp[j];
-                if (u >= c.pos.first and u <= c.pos.second) {    // Cxip contains u
-                    c4 += C(i, j);
-                    nterms++;
-                }
-            }
+    // Sweep the component boundaries: the components containing a nucleotide are pairwise exclusive, and it is enough
+    // to constrain the maximal such sets, which are the sets of active components right before one of them ends.
+    typedef struct {
+        uint   pos;
+        bool   end;    // at the same position, components start before others end: they share the nucleotide
+        size_t i, j;
+    } Boundary;
+    vector<Boundary> boundaries;
+    for (size_t i = 0; i < insertion_sites_.size(); i++)
+        for (size_t j = 0; j < insertion_sites_[i].comp.size(); j++) {
+            boundaries.push_back({ uint(insertion_sites_[i].comp[j].pos.first), false, i, j });
+            boundaries.push_back({ uint(insertion_sites_[i].comp[j].pos.second), true, i, j });
+        }
+    sort(boundaries.begin(), boundaries.end(),
+         [](const Boundary& a, const Boundary& b) { return tie(a.pos, a.end, a.i, a.j) < tie(b.pos, b.end, b.i, b.j); });
+    set<pair<size_t, size_t>> active;
+    bool                      grown = false;    // a component started since the last constraint
+    for (const Boundary& b : boundaries) {
+        if (!b.end) {
+            active.insert(make_pair(b.i, b.j));
+            grown = true;
+            continue;
         }
-        if (nterms > 1) {
+        if (grown and active.size() > 1) {
+            IloExpr c4(env_);
+            for (const pair<size_t, size_t>& ij : active) c4 += C(ij.first, ij.second);
             model_.add(c4 <= 1);
             if (verbose_) cout << "\t\t" << (c4 <= 1) << endl;
+            c4.end();
         }
+        grown = false;
+        active.erase(make_pair(b.i, b.j));
     }
     // Component completeness
     if (verbose_) cout << "\t> ensuring that motives cannot be partially included..." << endl;
@@ -452,6 +453,7 @@ void MOIP::define_problem_constraints(string& source)
         }
         model_.add(c5 == jm1 * C(i, 0));
         if (verbose_) cout << "\t\t> motif " << i << " : " << (c5 == jm1 * C(i, 0)) << endl;
+        c5.end();
     }
 
     // basepairs between components
@@ -466,12 +468,17 @@ void MOIP::define_problem_constraints(string& source)
 
             vector<size_t> weights(x.comp.size(), 0);
             vector<vector<IloExpr>> expressions(x.comp.size(), vector<IloExpr>());
+            vector<IloExpr>         created;    // every c6 once, some are shared by two components
 
             size_t sum_comp_size = 0;
 
-            for (size_t j=0; j < x.comp.size(); j++)
+            // the links number the nucleotides along the components of the RIN, which a reversed placement
+            // stores in the reverse order (see Motif::comp_index() and Motif::nt_position())
+            for (size_t t=0; t < x.comp.size(); t++)
             {
+                size_t j = x.comp_index(t);
                 IloExpr c6 = IloExpr(env_);
+                created.push_back(c6);
                 bool to_insert = false;
                 size_t jj;
 
@@ -483,18 +490,19 @@ void MOIP::define_problem_constraints(string& source)
                     //check if the j component is the first to be linked in the k link
                     if( sum_comp_size <= ntA && ntA < sum_comp_size + x.comp[j].k )
                     {
-                        size_t ntA_location = x.comp[j].pos.first + ntA - sum_comp_size;
+                        size_t ntA_location = x.nt_position(ntA);
                         size_t ntB_location = -1;
 
                         size_t sum_next_comp_size = sum_comp_size;
 
                         //look for the location of the other linked nucleotide
-                        for (jj=j; jj < x.comp.size(); jj++)
+                        for (size_t tt=t; tt < x.comp.size(); tt++)
                         {
                             //check if the jj component is the second to be linked in the k link
+                            jj = x.comp_index(tt);
                             if( sum_next_comp_size <= ntB && ntB < sum_next_comp_size + x.comp[jj].k )
                             {
-                                ntB_location = x.comp[jj].pos.first + ntB - sum_next_comp_size;
+                                ntB_location = x.nt_position(ntB);
                                 break;
                             }
 
@@ -549,6 +557,7 @@ void MOIP::define_problem_constraints(string& source)
                             model_.add( IloNum(weights[j]) * C(i,j) <= (expressions[j])[k] );
                             if (verbose_) cout << "\t\t" << (IloNum(weights[j]) * C(i, j) <= (expressions[j])[k]) << endl;
                         }
+            for (IloExpr& c6 : created) c6.end();
         }
     }
 
@@ -566,6 +575,7 @@ void MOIP::define_problem_constraints(string& source)
             if (verbose_) cout << "\t\t" << (IloNum(1) * C(i, 0) <= c6p) << endl;
 
             model_.add(C(i, 0) <= c6p);
+            c6p.end();
 
             if (x.comp.size() == 1)    // This constraint is for multi-component motives.
                 continue;
@@ -580,6 +590,7 @@ void MOIP::define_problem_constraints(string& source)
                 model_.add(C(i, j) <= c6);
 
                 if (verbose_) cout << "\t\t" << (IloNum(1) * C(i, j) <= c6) << endl;
+                c6.end();
             }
         }
     }
@@ -587,22 +598,49 @@ void MOIP::define_problem_constraints(string& source)
     // Forbid pseudoknots
     if (!this->allow_pk_) {
         if (verbose_) cout << "\t> forbidding pseudoknots..." << endl;
-        for (size_t u = 0; u < n - 6; u++)
-            for (size_t v = u + 4; v < n - 1; v++)
-                if (allowed_basepair(u, v))
-                    for (size_t k = u + 1; k < v; ++k)
-                        for (size_t l = v + 1; l < n; ++l)
-                            if (allowed_basepair(k, l)) {
-                                IloExpr c(env_);
-                                c += y(u, v);
-                                c += y(k, l);
-                                model_.add(c <= 1);
-                                if (verbose_) cout << "\t\t" << (c <= 1) << endl;
-                            }
+        size_t n_rows = 0;
+        switch (pk_formulation_) {
+        case 'A':
+            // one row per crossing: (u,v) and (k,l) cross iff u < k < v < l, the pairs (k,l>v) end the row of k
+            for (uint uv = 0; uv < basepairs_.size(); uv++) {
+                uint u = basepairs_[uv].first, v = basepairs_[uv].second;
+                auto ends_before_v = [v](const pair<uint, uint>& kl) { return kl.second <= v; };
+                for (uint k = u + 1; k < v; ++k) {
+                    auto row_end = basepairs_.begin() + first_basepair_[k + 1];
+                    auto kl      = partition_point(basepairs_.begin() + first_basepair_[k], row_end, ends_before_v);
+                    for (; kl != row_end; ++kl) {
+                        IloExpr c(env_);
+                        c += basepair_dv_[uv];
+                        c += basepair_dv_[kl - basepairs_.begin()];
+                        model_.add(c <= 1);
+                        n_rows++;
+                        if (verbose_) cout << "\t\t" << (c <= 1) << endl;
+                        c.end();
+                    }
+                }
+            }
+            break;
+        case 'B':
+            // one row per (u,v) and k inside it, covering all the crossings of (u,v) at k at once
+            for (uint uv = 0; uv < basepairs_.size(); uv++)
+                for (uint k = basepairs_[uv].first + 1; k < basepairs_[uv].second; ++k) {
+                    IloExpr c(env_);
+                    if (!crossing_clique(uv, k, c)) {    // nothing crosses (u,v) at k
+                        c.end();
+                        continue;
+                    }
+                    model_.add(c <= 1);
+                    n_rows++;
+                    if (verbose_) cout << "\t\t" << (c <= 1) << endl;
+                    c.end();
+                }
+            break;
+        }
+        if (verbose_ and n_rows) cout << "\t\t(" << n_rows << " rows)" << endl;
     }
 }
 
-SecondaryStructure MOIP::solve_objective(int o, double min, double max)
+SecondaryStructure MOIP::solve_objective(int o, double min, double max, bool verbose)
 {
     // Solves one of the objectives, under constraint that the other should be in [min, max]
 
@@ -613,375 +651,603 @@ SecondaryStructure MOIP::solve_objective(int o, double min, double max)
         max = max - min;
     }
 
-    // impose the bounds and the objective
-    IloObjective obj;
-    IloRange     bounds;
-    switch (o) {
-    case 1:
-        obj    = IloMaximize(env_, obj1);
-        bounds = IloRange(env_, min, obj2, max);
-        break;
-    case 2:
-        obj    = IloMaximize(env_, obj2);
-        bounds = IloRange(env_, min, obj1, max);
-        break;
+    // impose the bounds and the objective: the model stays extracted in cplex_, only these modifications are passed to it
+    if (o != objective_nbr_) {
+        objective_.setExpr(o == 1 ? obj1 : obj2);
+        objective_nbr_ = o;
     }
-    model_.add(obj);
-    model_.add(bounds);
-
-    IloCplex cplex_ = IloCplex(model_);
-    cplex_.setOut(env_.getNullStream());
-    // cplex_.exportModel("latestmodel.lp")
-
-    if (!cplex_.solve()) {
-        if (verbose_) cout << "\t> Failed to optimize LP: no more solutions to find." << endl;
-        // Removing the objective from the model_
-        model_.remove(obj);
-        model_.remove(bounds);
+    bounds_[o - 1].setBounds(-IloInfinity, IloInfinity);
+    bounds_[2 - o].setBounds(min, max);
+
+    auto solve_start = chrono::steady_clock::now();    // extraction (first solve only) and solve
+    if (cplex_.getImpl() == nullptr) {
+        cplex_ = IloCplex(model_);
+        cplex_.setOut(env_.getNullStream());
+        uint threads = cplex_threads_;
+        if (!threads and n_jobs_ > 1) threads = std::max(1u, Pool::available_cpus() / n_jobs_);    // a share of the CPUs per job
+        if (threads) cplex_.setParam(IloCplex::Param::Threads, threads);
+    }
+    if (!export_model_.empty()) cplex_.exportModel(export_path().c_str());    // the latest model solved by this solver
+
+    // Time budget of this solve: its own, and what is left of the whole search's
+    double time_limit = solve_time_limit_;
+    uint   cut_by     = SOLVE_TIME_LIMIT;
+    cut_short_ = false;
+    if (time_limit_ > 0 and (time_limit <= 0 or time_limit_ - elapsed() < time_limit)) {
+        time_limit = time_limit_ - elapsed();
+        cut_by     = TIME_LIMIT;
+        if (time_limit <= 0) {
+            status_ |= TIME_LIMIT;
+            cut_short_ = true;
+            return SecondaryStructure(true);
+        }
+    }
+    if (time_limit > 0) cplex_.setParam(IloCplex::Param::TimeLimit, time_limit);
+
+    bool                 solved = cplex_.solve();
+    IloAlgorithm::Status status = cplex_.getStatus();
+    if (verbose) cout << "\t> Solved in " << chrono::duration<double>(chrono::steady_clock::now() - solve_start).count() << " s" << endl;
+    cut_short_ = time_limit > 0 and (status == IloAlgorithm::Feasible or status == IloAlgorithm::Unknown);
+    if (cut_short_) {
+        // Stopped by the time limit: this interval is left unexplored. A solution found by then is not proven optimal, it
+        // could be dominated by a structure of the interval, and split it at the wrong place: it is not kept.
+        status_ |= cut_by;
+        if (verbose) cout << "\t> Time limit reached" << (solved ? ", the solution is not proven optimal, not kept." : ", no solution found.") << endl;
+    }
+    if (!solved) {
+        if (verbose and !cut_short_) cout << "\t> Failed to optimize LP: no more solutions to find." << endl;
         return SecondaryStructure(true);
     }
 
-    if (verbose_)
+    IloNumArray values(env_);    // basepair_dv_ then insertion_dv_, as in all_dv_
+    cplex_.getValues(values, all_dv_);
+    if (cut_short_) {
+        // still a feasible point, where the next search can start from
+        if (cplex_.getNMIPStarts()) cplex_.deleteMIPStarts(0, cplex_.getNMIPStarts());
+        cplex_.addMIPStart(all_dv_, values, IloCplex::MIPStartRepair);
+        values.end();
+        return SecondaryStructure(true);
+    }
+
+    if (verbose)
         cout << "\t> Solution status: objective values (" << cplex_.getValue(obj1) << ", " << cplex_.getValue(obj2) << ')';
 
+    const IloInt n_y = basepair_dv_.getSize();
+
     // Build a secondary Structure
-    SecondaryStructure best_ss = SecondaryStructure(rna_);
+    SecondaryStructure best_ss = SecondaryStructure(rna_, insertion_sites_);
     // if (verbose_) cout << "\t\t>retrieveing motifs inserted in the result secondary structure..." << endl;
     for (size_t i = 0; i < insertion_sites_.size(); i++)
         // A constraint requires that all the components are inserted or none, so testing the first is enough:
-        if (cplex_.getValue(insertion_dv_[index_of_first_components[i]]) > 0.5)
-            best_ss.insert_motif(insertion_sites_[i]);
+        if (values[n_y + index_of_first_components[i]] > 0.5)
+            best_ss.insert_motif(i);
 
     // if (verbose_) cout << "\t\t>retrieving basepairs of the result secondary structure..." << endl;
-    for (size_t u = 0; u < rna_.get_RNA_length() - 6; u++)
-        for (size_t v = u + 4; v < rna_.get_RNA_length(); v++)
-            if (allowed_basepair(u, v))
-                if (cplex_.getValue(y(u, v)) > 0.5) best_ss.set_basepair(u, v);
+    for (size_t c = 0; c < basepairs_.size(); c++)
+        if (values[c] > 0.5) best_ss.set_basepair(basepairs_[c].first, basepairs_[c].second);
 
-    best_ss.sort();    // order the basepairs in the vector
+    best_ss.sort();    // order the basepairs and motifs, and hash them
     best_ss.set_objective_score(2, cplex_.getValue(obj2));
     best_ss.set_objective_score(1, cplex_.getValue(obj1));
 
-    // if (verbose_) cout << "\t\t>building the IP forbidding condition..." << endl;
     // Forbidding to find best_ss later
-    IloExpr c(env_);
-    for (uint d = 0; d < insertion_dv_.getSize(); d++)
-        if (cplex_.getValue(insertion_dv_[d]) > 0.5)
-            c += IloNum(1) - insertion_dv_[d];
-        else
-            c += insertion_dv_[d];
-    for (uint d = 0; d < basepair_dv_.getSize(); d++)
-        if (cplex_.getValue(basepair_dv_[d]) > 0.5)
-            c += IloNum(1) - basepair_dv_[d];
-        else
-            c += basepair_dv_[d];
-    model_.add(c >= IloNum(1));
+    forbid(best_ss);
+
+    // Start the next search from this Pareto point: the cut above forbids it, but its neighbours are a few flips away
+    // and CPLEX repairs it into one of them, instead of starting the branch-and-bound from nothing.
+    if (cplex_.getNMIPStarts()) cplex_.deleteMIPStarts(0, cplex_.getNMIPStarts());
+    cplex_.addMIPStart(all_dv_, values, IloCplex::MIPStartRepair);
+    values.end();
 
-    // exit
-    model_.remove(bounds);
-    model_.remove(obj);
     return best_ss;
 }
 
-void MOIP::search_between(double lambdaMin, double lambdaMax)
+void MOIP::search_front(SecondaryStructure& best1, SecondaryStructure& best2)
 {
-    SecondaryStructure s = solve_objective(obj_to_solve_, lambdaMin, lambdaMax);
-    if (!s.is_empty_structure) {    // A solution has been found
+    // The best solutions of each objective, then search_between() on top of and below the best solution of obj_to_solve_.
+    // A resumed search starts from the intervals its checkpoint had left instead.
+    if (!(resume_ and load_checkpoint())) {
+        for (int o : { 1, 2 }) {
+            SecondaryStructure& extreme = (o == 1) ? best1 : best2;
+            extreme = solve_objective(o, -DBL_MAX, DBL_MAX);
+            if (verbose_) cout << endl;
+            if (!extreme.is_empty_structure)
+                found_.push_back(extreme);
+            else if (cut_short_)
+                unexplored_.push_back({ o, -DBL_MAX, DBL_MAX });    // a resumed search explores the whole front from this objective
+        }
 
-        // if the solution is dominated, ignore it
-        if (!is_undominated_yet(s)) {
-            if (verbose_) cout << ", but structure is dominated." << endl;
-            return;
+        const SecondaryStructure& best  = (obj_to_solve_ == 1) ? best1 : best2;
+        const SecondaryStructure& other = (obj_to_solve_ == 1) ? best2 : best1;
+        if (!best.is_empty_structure)
+            add_solution(best);    // both are missing only if a budget ran out
+        else if (!other.is_empty_structure)
+            add_solution(other);    // it is forbidden in the model now: kept, or no search would find it again
+        if (!best.is_empty_structure and !other.is_empty_structure) {
+            if (verbose_) {
+                cout << endl << "Best solution according to objective 1 :" << best1.to_string() << endl;
+                cout << "Best solution according to objective 2 :" << best2.to_string() << endl;
+            }
+            // extend the Pareto set on top, then below
+            double v = best.get_objective_score(3 - obj_to_solve_);
+            pending_.push_back({ int(obj_to_solve_), -DBL_MAX, v });
+            pending_.push_back({ int(obj_to_solve_), v + precision_, other.get_objective_score(3 - obj_to_solve_) });
         }
+    }
+    explore_pending();
+    end_checkpoints();
+}
 
-        // adding the SecondaryStructure s to the set pareto_
-        if (verbose_) cout << ", not dominated." << endl;
-        add_solution(s);
-
-        // check if some labels should be updated on the vertical
-        if (exists_vertical_outdated_labels(s))
-            for (vector<SecondaryStructure>::iterator x = pareto_.end() - 2; x >= pareto_.begin(); x--)
-                if (
-                abs(x->get_objective_score(obj_to_solve_) - s.get_objective_score(obj_to_solve_)) < precision_ and
-                precision_ < s.get_objective_score(3 - obj_to_solve_) - x->get_objective_score(3 - obj_to_solve_)) {
-                    if (verbose_)
-                        cout << "\t> removing structure from Pareto set, obj " << 3 - obj_to_solve_ << " = "
-                             << x->get_objective_score(3 - obj_to_solve_) << endl;
-                    pareto_.erase(x);
-                }
+void MOIP::search_between(double lambdaMin, double lambdaMax)
+{
+    pending_.push_back({ int(obj_to_solve_), lambdaMin, lambdaMax });
+    explore_pending();
+}
 
-        // search on top
-        double min = s.get_objective_score(3 - obj_to_solve_) + precision_;
-        double max = lambdaMax;
+void MOIP::explore_pending(void)
+{
+    // Depth-first, like a recursion on the intervals: the part on top of a solution is explored before the part below it.
+    // The intervals left are kept in pending_, so that a checkpoint can save them.
+    while (!pending_.empty()) {
+        if (out_of_budget()) return;    // anytime search: the front found so far is kept
+        if (checkpoint_due()) {
+            deque<Interval> pending = pending_;    // with those left unexplored
+            pending.insert(pending.end(), unexplored_.begin(), unexplored_.end());
+            save_checkpoint(pending, pareto_, found_);
+        }
+
+        Interval t = pending_.back();
+        pending_.pop_back();
         if (verbose_)
-            cout << std::setprecision(-log10(precision_) + 4) << "\nSolving objective function " << obj_to_solve_
-                 << ", on top of " << s.get_objective_score(3 - obj_to_solve_) << ": Obj" << 3 - obj_to_solve_
-                 << "  being in [" << std::setprecision(-log10(precision_) + 4) << min << ", "
-                 << std::setprecision(-log10(precision_) + 4) << max << "]..." << endl;
-        search_between(min, max);
-
-
-        if (std::abs(max - min) - precision_ > precision_) {
-
-            // search below
-            min = lambdaMin;
-            max = s.get_objective_score(3 - obj_to_solve_);
-            if (verbose_)
-                cout << std::setprecision(-log10(precision_) + 4) << "\nSolving objective function " << obj_to_solve_
-                     << ", below (or eq. to) " << max << ": Obj" << 3 - obj_to_solve_ << "  being in ["
-                     << std::setprecision(-log10(precision_) + 4) << min << ", "
-                     << std::setprecision(-log10(precision_) + 4) << max << "]..." << endl;
-            search_between(min, max);
+            cout << std::setprecision(-log10(precision_) + 4) << "\nSolving objective function " << t.o << ": Obj" << 3 - t.o
+                 << "  being in [" << t.min << ", " << t.max << "]..." << endl;
+        SecondaryStructure s = solve_objective(t.o, t.min, t.max);
+        if (s.is_empty_structure) {
+            if (cut_short_)
+                unexplored_.push_back(t);    // explored again if the search is resumed
+            else if (verbose_)
+                cout << "\t> no solutions found." << endl;
+            continue;
         }
+        found_.push_back(s);
+
+        // if the solution is dominated, ignore it
+        if (!insert_in_pareto(s)) continue;
+
+        double v = s.get_objective_score(3 - t.o);
+        if (std::abs(t.max - v - precision_) - precision_ > precision_) pending_.push_back({ t.o, t.min, v });    // below
+        pending_.push_back({ t.o, v + precision_, t.max });    // on top
+    }
+}
 
-    } else {
-        if (verbose_) cout << "\t> no solutions found." << endl;
+bool MOIP::insert_in_pareto(const SecondaryStructure& s)
+{
+    if (pareto_.is_dominated(s)) {
+        if (verbose_) cout << ", but structure is dominated." << endl;
+        return false;
     }
+
+    // adding the SecondaryStructure s to the set pareto_, which drops the structures it dominates
+    if (verbose_) cout << ", not dominated." << endl;
+    add_solution(s);
+    return true;
 }
 
-bool MOIP::exists_vertical_outdated_labels(const SecondaryStructure& s) const
+void MOIP::search_in_parallel(SecondaryStructure& best1, SecondaryStructure& best2)
 {
-    bool result = false;
-    for (auto x : pareto_)
-        if (x != s and abs(x.get_objective_score(obj_to_solve_) - s.get_objective_score(obj_to_solve_)) < precision_)
-            result = true;
-    if (result)
-        for (auto x : pareto_)
-            if (
-            x != s and abs(x.get_objective_score(1) - s.get_objective_score(1)) < precision_ and
-            abs(x.get_objective_score(2) - s.get_objective_score(2)) < precision_)
-                result = false;
-    return result;
+    // Same exploration as the two solve_objective() on the extremes, then search_between() on top of and below the best
+    // solution of obj_to_solve_. But once split, the intervals of the objective space are independent subproblems:
+    // n_solvers_ solvers, each in its own CPLEX environment, take them from a shared queue. search_between() relies on
+    // the cuts accumulated in its single model, so a solver first forbids the solutions found by the others which lie
+    // in its interval.
+    uint n_solvers = std::max(2u, n_solvers_);
+    uint cplex_threads = std::max(1u, Pool::available_cpus() / std::max(1u, n_jobs_) / n_solvers);    // split this job's CPUs between the solvers
+
+    mutex                lock, writing;    // writing: the checkpoints, saved out of the lock
+    condition_variable   changed;
+    uint                 busy = 0, extremes = 0;
+    size_t               n_snapshots = 0, n_saved = 0;    // checkpoints taken and written, to never overwrite a newer one
+    vector<Interval>     running(n_solvers);                         // by solver, the interval it is exploring
+    vector<bool>         is_running(n_solvers, false);
+    vector<vector<bool>> forbidden(n_solvers, vector<bool>());    // by solver, is found_[k] forbidden in its model ?
+    exception_ptr        error;
+
+    // the intervals to explore are queued in pending_, and every solution found, by any solver, in found_
+    if (!(resume_ and load_checkpoint())) {
+        pending_  = { { 1, -DBL_MAX, DBL_MAX }, { 2, -DBL_MAX, DBL_MAX } };
+        extremes = 2;
+    }
+    forbidden[0].resize(found_.size(), true);    // a resumed search forbids them in this model
+
+    cplex_threads_ = cplex_threads;
+    if (verbose_) cout << "\t> " << n_solvers << " solvers of " << cplex_threads << " threads each" << endl;
+
+    auto explore = [&](uint m) {
+        try {
+            unique_ptr<MOIP> other;
+            if (m) other = replica(m, cplex_threads);
+            MOIP& solver = m ? *other : *this;
+
+            unique_lock<mutex> l(lock);
+            while (true) {
+                changed.wait(l, [&]() { return !pending_.empty() or !busy or error; });
+                if (pending_.empty() or error) break;    // nothing left, and nobody to find more
+                if (out_of_budget()) break;    // the front found so far is kept
+                Interval t = pending_.front();
+                pending_.pop_front();
+                busy++;
+                running[m]    = t;
+                is_running[m] = true;
+                vector<const SecondaryStructure*> to_forbid;
+                forbidden[m].resize(found_.size(), false);
+                for (size_t k = 0; k < found_.size(); k++) {
+                    double v = found_[k].get_objective_score(3 - t.o);
+                    if (!forbidden[m][k] and t.min - precision_ <= v and v <= t.max + precision_) {
+                        to_forbid.push_back(&found_[k]);    // a deque does not move its elements when it grows
+                        forbidden[m][k] = true;
+                    }
+                }
+                l.unlock();
+
+                for (const SecondaryStructure* x : to_forbid) solver.forbid(*x);
+                SecondaryStructure s = solver.solve_objective(t.o, t.min, t.max, false);    // silent: progress is reported below
+
+                l.lock();
+                busy--;
+                is_running[m] = false;
+                status_ |= solver.status_;    // budgets exhausted by a replica stop everyone
+                bool is_extreme = extremes and t.min == -DBL_MAX and t.max == DBL_MAX;    // resumed, a whole interval like the others
+                if (s.is_empty_structure and solver.cut_short_)
+                    unexplored_.push_back(t);    // explored again if the search is resumed
+                if (!s.is_empty_structure) {
+                    s.insertion_sites_ = &insertion_sites_;    // same sites as the replica's
+                    found_.push_back(s);
+                    forbidden[m].resize(found_.size(), false);
+                    forbidden[m].back() = true;    // solve_objective() did
+                    if (verbose_) cout << "\t> solver " << m << ": (" << s.get_objective_score(1) << ", " << s.get_objective_score(2) << ")";
+                }
+                if (is_extreme) {
+                    // one of the extremes: once both are known, start the search from the best for obj_to_solve_
+                    (t.o == 1 ? best1 : best2) = s;
+                    if (verbose_ and !s.is_empty_structure) cout << " is the best for objective " << t.o << endl;
+                    if (!--extremes) {
+                        const SecondaryStructure& best  = (obj_to_solve_ == 1) ? best1 : best2;
+                        const SecondaryStructure& other = (obj_to_solve_ == 1) ? best2 : best1;
+                        if (!best.is_empty_structure)
+                            add_solution(best);    // both are missing only if a budget ran out
+                        else if (!other.is_empty_structure)
+                            add_solution(other);    // it is forbidden in the models now: kept, or no search would find it again
+                        if (!best.is_empty_structure and !other.is_empty_structure) {
+                            pending_.push_back({ int(obj_to_solve_), best.get_objective_score(3 - obj_to_solve_) + precision_,
+                                             other.get_objective_score(3 - obj_to_solve_) });
+                            pending_.push_back({ int(obj_to_solve_), -DBL_MAX, best.get_objective_score(3 - obj_to_solve_) });
+                        }
+                    }
+                } else if (!s.is_empty_structure) {
+                    if (verbose_) cout << " in [" << t.min << ", " << t.max << "]";
+                    if (insert_in_pareto(s)) {
+                        // the two halves left, as search_between() would explore them
+                        double v = s.get_objective_score(3 - t.o);
+                        pending_.push_back({ t.o, v + precision_, t.max });
+                        if (std::abs(t.max - v - precision_) - precision_ > precision_) pending_.push_back({ t.o, t.min, v });
+                    }
+                }
+                changed.notify_all();
+
+                if (!extremes and checkpoint_due()) {
+                    // a copy of the state, taken under the lock, and written once it is released
+                    deque<Interval> pending = pending_;    // with those being explored, and those left unexplored
+                    for (uint k = 0; k < n_solvers; k++)
+                        if (is_running[k]) pending.push_back(running[k]);
+                    pending.insert(pending.end(), unexplored_.begin(), unexplored_.end());
+                    ParetoArchive             pareto   = pareto_;
+                    deque<SecondaryStructure> found    = found_;
+                    size_t                    snapshot = ++n_snapshots;
+                    l.unlock();
+                    {
+                        lock_guard<mutex> w(writing);
+                        if (snapshot > n_saved) {
+                            save_checkpoint(pending, pareto, found);
+                            n_saved = snapshot;
+                        }
+                    }
+                    l.lock();
+                }
+            }
+        } catch (...) {
+            lock_guard<mutex> l(lock);
+            if (!error) error = current_exception();
+            changed.notify_all();
+        }
+    };
+
+    vector<thread> threads;
+    for (uint m = 1; m < n_solvers; m++) threads.push_back(thread(explore, m));
+    explore(0);
+    for (thread& t : threads) t.join();
+    if (error) rethrow_exception(error);
+    if (extremes) {
+        pending_.clear();    // a budget ran out before the search was split: nothing worth saving
+        unexplored_.clear();
+    }
+    end_checkpoints();
 }
 
-bool MOIP::exists_horizontal_outdated_labels(const SecondaryStructure& s) const
+void MOIP::forbid(const SecondaryStructure& s)
 {
-    bool result = false;
-    for (auto x : pareto_)
-        if (x != s and abs(x.get_objective_score(3 - obj_to_solve_) - s.get_objective_score(3 - obj_to_solve_)) < precision_)
-            result = true;
-    if (result)
-        for (auto x : pareto_)
-            if (
-            x != s and abs(x.get_objective_score(1) - s.get_objective_score(1)) < precision_ and
-            abs(x.get_objective_score(2) - s.get_objective_score(2)) < precision_)
-                result = false;
-    return result;
+    // No-good cut: at least one of the decision variables must take another value than in s
+    vector<bool> in_s(all_dv_.getSize(), false);
+    for (const pair<uint, uint>& bp : s.basepairs_) in_s[get_yuv_index(bp.first, bp.second)] = true;
+    for (uint i : s.motifs_)
+        for (size_t d : index_of_Cxip_[i]) in_s[basepair_dv_.getSize() + d] = true;    // all or none of the components are
+    IloExpr c(env_);
+    for (IloInt d = 0; d < all_dv_.getSize(); d++)
+        if (in_s[d])
+            c += IloNum(1) - all_dv_[d];
+        else
+            c += all_dv_[d];
+    model_.add(c >= IloNum(1));
+    c.end();
 }
 
 void MOIP::add_solution(const SecondaryStructure& s)
 {
     if (verbose_) cout << "\t> adding structure to Pareto set :\t" << s.to_string() << endl;
-    pareto_.push_back(s);
-    if (pareto_.size() > max_sol_nbr_) {
-        cerr << "\033[31m Quitting because combinatorial issues (>" << max_sol_nbr_ << " solutions in Pareto set). \033[0m" << endl;
-        exit(1);
-    }
+    if (pareto_.insert(s) and on_solution_) on_solution_(s);
+    if (pareto_.size() > max_sol_nbr_) status_ |= SOLUTION_LIMIT;    // combinatorial issues: the search stops, with the front found so far
 }
 
-size_t MOIP::get_yuv_index(size_t u, size_t v) const
+bool MOIP::out_of_budget(void)
 {
-    size_t a, b;
-    a = (u < v) ? u : v;
-    b = (u > v) ? u : v;
-    return index_of_yuv_[a][b - 4 - a];
+    if (time_limit_ > 0 and elapsed() >= time_limit_) status_ |= TIME_LIMIT;
+    return status_ & (TIME_LIMIT | SOLUTION_LIMIT);    // a solve stopped by its own limit does not stop the others
 }
 
-size_t MOIP::get_Cpxi_index(size_t x_i, size_t i_on_j) const { return index_of_Cxip_[x_i][i_on_j]; }
+double MOIP::elapsed(void) const { return chrono::duration<double>(chrono::steady_clock::now() - start_).count(); }
 
+string MOIP::status_string(void) const
+{
+    if (status_ == COMPLETE) return "complete";
+    vector<string> reasons;
+    if (status_ & TIME_LIMIT) reasons.push_back("time limit reached");
+    if (status_ & SOLVE_TIME_LIMIT) reasons.push_back("solve time limit reached");
+    if (status_ & SOLUTION_LIMIT) reasons.push_back(">" + to_string(max_sol_nbr_) + " solutions");
+    return "incomplete: " + boost::algorithm::join(reasons, ", ");
+}
 
+/*
+    Checkpoints of a search, in checkpoint_dir_: one text file per problem, named after checkpoint_key().
+    biorseo-checkpoint <version> <key> <sequence> <number of insertion sites>
+    intervals <n>, then one "o min max" line per interval left to explore
+    pareto <n>, then one line per structure of the Pareto set
+    found <n>, then one line per structure found, hence forbidden in the model
+    A structure is "obj1 obj2 n_basepairs u v u v ... n_motifs site site ...", sites as indexes in insertion_sites_.
+*/
 
-void MOIP::remove_solution(uint i) { pareto_.erase(pareto_.begin() + i); }
+static const int checkpoint_version = 2;
+
+uint64_t MOIP::checkpoint_key(void) const
+{
+    // A checkpoint is only valid for the same model, and the same order of the search: same sequence, same candidate
+    // basepairs (theta), same insertion sites (library), same objectives. The budgets may change between runs.
+    // The key is a 64-bit FNV-1a hash of a text serialization of all that, stable across compilers and library versions.
+    ostringstream problem;
+    problem << std::setprecision(numeric_limits<double>::max_digits10);
+    problem << rna_->get_seq() << '\n';
+    for (const pair<uint, uint>& bp : basepairs_) problem << bp.first << ' ' << bp.second << ';';
+    problem << '\n';
+    for (const Motif& m : insertion_sites_) problem << m.get_identifier() << ' ' << m.pos_string() << ' ' << m.score_ << ';';
+    problem << '\n' << obj_function_ << ' ' << allow_pk_ << ' ' << obj_to_solve_ << ' ' << precision_;
+
+    uint64_t key = 14695981039346656037ULL;    // FNV offset basis
+    for (unsigned char c : problem.str()) {
+        key ^= c;
+        key *= 1099511628211ULL;    // FNV prime
+    }
+    return key;
+}
 
+string MOIP::checkpoint_path(void) const
+{
+    return (path(checkpoint_dir_) / (boost::str(boost::format("%016x") % checkpoint_key()) + ".checkpoint")).string();
+}
 
+void MOIP::save_checkpoint(const deque<Interval>& pending, const ParetoArchive& pareto, const deque<SecondaryStructure>& found)
+{
+    // Written next to the previous one, then renamed over it: a preemption never leaves a truncated checkpoint
+    string        final_path = checkpoint_path();
+    string        temp_path  = final_path + ".tmp";
+    std::ofstream file(temp_path);
+    file << std::setprecision(numeric_limits<double>::max_digits10);
+
+    auto write_structure = [&file](const SecondaryStructure& s) {
+        file << s.get_objective_score(1) << ' ' << s.get_objective_score(2) << ' ' << s.basepairs_.size();
+        for (const pair<uint, uint>& bp : s.basepairs_) file << ' ' << bp.first << ' ' << bp.second;
+        file << ' ' << s.motifs_.size();
+        for (uint i : s.motifs_) file << ' ' << i;
+        file << '\n';
+    };
+
+    file << "biorseo-checkpoint " << checkpoint_version << ' ' << checkpoint_key() << ' ' << rna_->get_seq() << ' '
+         << insertion_sites_.size() << '\n';
+    file << "intervals " << pending.size() << '\n';
+    for (const Interval& t : pending) file << t.o << ' ' << t.min << ' ' << t.max << '\n';
+    file << "pareto " << pareto.size() << '\n';
+    for (const SecondaryStructure& s : pareto) write_structure(s);
+    file << "found " << found.size() << '\n';
+    for (const SecondaryStructure& s : found) write_structure(s);
+    file.close();
+
+    boost::system::error_code error;
+    if (file) boost::filesystem::rename(temp_path, final_path, error);
+    if (!file or error)
+        cerr << "\033[33mCould not save the checkpoint " << final_path << ", the search goes on without it.\033[0m" << endl;
+    else if (verbose_)
+        cout << "\t> Checkpoint saved to " << final_path << " (" << pareto.size() << " solutions, " << pending.size() << " intervals left)" << endl;
+}
 
-bool MOIP::allowed_basepair(size_t u, size_t v) const
+bool MOIP::checkpoint_due(void)
 {
-    size_t a, b;
-    a = (v > u) ? u : v;
-    b = (v > u) ? v : u;
-    if (b - a < 4) return false;
-    if (a >= rna_.get_RNA_length() - 6) return false;
-    if (b >= rna_.get_RNA_length()) return false;
-    if (get_yuv_index(a, b) == rna_.get_RNA_length() * rna_.get_RNA_length() + 1)
-        return false;    // not allowed because proba < theta
+    if (checkpoint_dir_.empty()) return false;
+    auto now = chrono::steady_clock::now();
+    if (chrono::duration<double>(now - last_checkpoint_).count() < checkpoint_interval_) return false;
+    last_checkpoint_ = now;
     return true;
 }
 
-void MOIP::allowed_motifs_from_desc(args_of_parallel_func arg_struct)
+bool MOIP::load_checkpoint(void)
 {
-    /*
-        Searches where to place some DESC module in the RNA
-        Too short components are extended in all possible directions.
-    */
-    path           descfile                 = arg_struct.motif_file;
-    mutex&         posInsertionSites_access = arg_struct.posInsertionSites_mutex;
-
-    std::ifstream             motif;
-    vector<vector<Component>> vresults;
-    string                    line;
-    string                    seq;
-    vector<string>            component_sequences;
-    vector<string>            bases;
-    int                       last;
-    char                      c    = 'a';
-    char*                     prev = &c;
-    string                      rna  = rna_.get_seq();
-
-    motif = std::ifstream(descfile.string());
-    getline(motif, line);    // ignore "id: number"
-    getline(motif, line);    // Bases: 866_G  867_G  868_G  869_G  870_U  871_A ...
-    boost::split(bases, line, [prev](char c) {
-        bool res = (*prev == ' ' or *prev == ':');
-        *prev    = c;
-        return (c == ' ' and res);
-    });    // get a vector of 866_G, 867_G, etc...
-
-    seq  = "";
-    last = stoi(bases[1].substr(0, bases[1].find('_')));
-    for (vector<string>::iterator b = bases.begin() + 1; b != bases.end() - 1; b++) {
-        char nt  = b->substr(b->find('_') + 1, 1).back();
-        int  pos = stoi(b->substr(0, b->find('_')));
-
-        if (pos - last > 5) {    // finish this component and start a new one
-            component_sequences.push_back(seq);
-            seq = "";
-        } else if (pos - last == 2) {
-            seq += '.';
-        } else if (pos - last == 3) {
-            seq += "..";
-        } else if (pos - last == 4) {
-            seq += "...";
-        } else if (pos - last == 5) {
-            seq += "....";
+    if (checkpoint_dir_.empty()) return false;
+    string        checkpoint = checkpoint_path();
+    std::ifstream file(checkpoint);
+    if (!file) return false;    // nothing to resume, start from scratch
+
+    string                    word, sequence;
+    int                       version;
+    uint64_t                  key;
+    size_t                    n_sites, n;
+    deque<Interval>           pending;
+    deque<SecondaryStructure> pareto, found;
+
+    auto read_structure = [&](deque<SecondaryStructure>& structures) {
+        SecondaryStructure s(rna_, insertion_sites_);
+        double             obj1, obj2;
+        size_t             n_bp, n_motifs;
+        uint               u, v;
+        if (!(file >> obj1 >> obj2 >> n_bp)) return false;
+        for (size_t k = 0; k < n_bp; k++) {
+            if (!(file >> u >> v) or !allowed_basepair(u, v)) return false;
+            s.set_basepair(u, v);
+        }
+        if (!(file >> n_motifs)) return false;
+        for (size_t k = 0; k < n_motifs; k++) {
+            if (!(file >> u) or u >= insertion_sites_.size()) return false;
+            s.insert_motif(u);
         }
-        seq += nt;
-        last = pos;
+        s.sort();
+        s.set_objective_score(1, obj1);
+        s.set_objective_score(2, obj2);
+        structures.push_back(s);
+        return true;
+    };
+    auto read_structures = [&](const char* section, deque<SecondaryStructure>& structures) {
+        if (!(file >> word >> n) or word != section) return false;
+        for (size_t k = 0; k < n; k++)
+            if (!read_structure(structures)) return false;
+        return true;
+    };
+
+    // the sequence and the number of sites catch a collision of the keys
+    bool valid = (file >> word >> version >> key >> sequence >> n_sites) and word == "biorseo-checkpoint" and version == checkpoint_version and
+                 key == checkpoint_key() and sequence == rna_->get_seq() and n_sites == insertion_sites_.size();
+    valid = valid and (file >> word >> n) and word == "intervals";
+    for (size_t k = 0; valid and k < n; k++) {
+        Interval t;
+        valid = (file >> t.o >> t.min >> t.max) and (t.o == 1 or t.o == 2);
+        pending.push_back(t);
     }
-    component_sequences.push_back(seq);
-    // Now component_sequences is a vector of sequences like {AGCGC, CGU..GUUU}
-
-    // identify components of length 1 or 2, then extend them to length 3
-    vector<uint> comp_of_size_1;
-    vector<uint> comp_of_size_2;
-    for (uint p = 0; p < component_sequences.size(); ++p) {
-        if (component_sequences[p].length() == 1) comp_of_size_1.push_back(p);
-        if (component_sequences[p].length() == 2) comp_of_size_2.push_back(p);
+    valid = valid and read_structures("pareto", pareto) and read_structures("found", found);
+    if (!valid) {
+        cerr << "\033[33m" << checkpoint << " is not a checkpoint of this problem, the search starts from scratch.\033[0m" << endl;
+        return false;
     }
-    if (comp_of_size_1.size() or comp_of_size_2.size()) {
-        // We have short components to extend.
-        // We will look at all the possible extensions of the motifs for which all 
-        // components have length 3 or more, and store the variants in motif_variants:
-        vector<vector<string>> motif_variants;
-
-        component_sequences.clear();    // rebuild from scratch
-        motif_variants.push_back(component_sequences);
-        uint actual_comp = 0;
-
-        seq  = "";
-        last = stoi(bases[1].substr(0, bases[1].find('_')));
-        for (vector<string>::iterator b = bases.begin() + 1; b < bases.end() - 1; b++) {
-            int  pos = stoi(b->substr(0, b->find('_')));
-            char nt  = b->substr(b->find('_') + 1, 1).back();
-            if (comp_of_size_1.size() and actual_comp == comp_of_size_1[0])    // we are on the first component of size 1
-            {
-                b--;
-                nt          = b->substr(b->find('_') + 1, 1).back();
-                string seq1 = "";
-                seq1 += nt;
-                seq1 += "..";
-                string seq2 = ".";
-                seq2 += nt;
-                seq2 += ".";
-                string seq3 = "..";
-                seq3 += nt;
-                uint end = motif_variants.size();    // before to add the new ones
-                for (uint u = 0; u < end; ++u) {
-                    motif_variants.push_back(motif_variants[u]);    // copy 1 for seq2
-                    motif_variants.back().push_back(seq2);
-                    motif_variants.push_back(motif_variants[u]);    // copy 2 for seq3
-                    motif_variants.back().push_back(seq3);
-                    motif_variants[u].push_back(seq1);
-                }
-                seq = "";
-                actual_comp++;
-                comp_of_size_1.erase(comp_of_size_1.begin());    // the first element has been processed, remove it
-                last = pos;
-            } else if (comp_of_size_2.size() and actual_comp == comp_of_size_2[0]) {    // we are on the first component of size 2
-                b--;
-                nt = b->substr(b->find('_') + 1, 1).back();
-                b++;    // skip the next nucleotide
-                char next   = b->substr(b->find('_') + 1, 1).back();
-                last        = stoi(b->substr(0, b->find('_')));
-                string seq1 = "";
-                seq1 += nt;
-                seq1 += next;
-                seq1 += ".";
-                string seq2 = ".";
-                seq2 += nt;
-                seq2 += next;
-                uint end = motif_variants.size();    // before to add the new one
-                for (uint u = 0; u < end; ++u) {
-                    motif_variants.push_back(motif_variants[u]);    // copy 1 for seq2
-                    motif_variants.back().push_back(seq2);
-                    motif_variants[u].push_back(seq1);
-                }
-                seq = "";
-                actual_comp++;
-                comp_of_size_2.erase(comp_of_size_2.begin());    // the first element has been processed, remove it
-            } else {                                             // we are on a longer component
-                if (pos - last > 5) {                            // finish this component and start a new one
-                    actual_comp++;
-                    for (vector<string>& c_s : motif_variants) c_s.push_back(seq);
-                    seq = "";
-                } else if (pos - last == 2) {
-                    seq += '.';
-                } else if (pos - last == 3) {
-                    seq += "..";
-                } else if (pos - last == 4) {
-                    seq += "...";
-                } else if (pos - last == 5) {
-                    seq += "....";
-                }
-                seq += nt;
-                last = pos;
-            }
-        }
-        for (auto c_s : motif_variants)
-            if (seq.length()) c_s.push_back(seq);    // pushing the last one after iterating over the bases
 
-        // We need to search for the different positions where to insert the first component
-        for (auto c_s : motif_variants) {
-            vector<vector<Component>> new_results = find_next_ones_in(rna, 0, c_s);
-            vresults.insert(vresults.end(), new_results.begin(), new_results.end());
-        }
+    pending_ = pending;
+    found_   = found;
+    for (const SecondaryStructure& s : pareto) pareto_.insert(s);
+    for (const SecondaryStructure& s : found_) forbid(s);
+    if (verbose_)
+        cout << "\t> Resuming from " << checkpoint << ": " << pareto_.size() << " solutions, " << pending_.size() << " intervals left" << endl;
+    return true;
+}
 
-    } 
-    else 
-    {
-        // No multiple motif variants : we serach in a single vector component_sequences
-        // We need to search for the different positions where to insert the first component
-        vresults = find_next_ones_in(rna, 0, component_sequences);
-    }
+void MOIP::end_checkpoints(void)
+{
+    if (checkpoint_dir_.empty()) return;
+    pending_.insert(pending_.end(), unexplored_.begin(), unexplored_.end());    // a resumed search retries them
+    unexplored_.clear();
+    if (pending_.empty()) {
+        boost::system::error_code error;
+        boost::filesystem::remove(checkpoint_path(), error);    // the search is over, nothing to resume
+    } else
+        save_checkpoint(pending_, pareto_, found_);    // stopped by a budget: a resumed run continues from here
+}
+
+string MOIP::export_path(void) const
+{
+    // Concurrent jobs and solvers would write the same file at the same time: model.lp becomes model.job2.solver1.lp
+    path   p(export_model_);
+    string tags;
+    if (n_jobs_ > 1) tags += ".job" + to_string(job_);
+    if (n_solvers_ > 1) tags += ".solver" + to_string(solver_);
+    return (p.parent_path() / (p.stem().string() + tags + p.extension().string())).string();
+}
+
+size_t MOIP::find_basepair(size_t u, size_t v) const
+{
+    // one lookup in the band of the pairs (a, a < b <= a + max_span_)
+    size_t a = (u < v) ? u : v;
+    size_t b = (u > v) ? u : v;
+    if (a == b or b - a > max_span_ or b >= rna_->get_RNA_length()) return basepairs_.size();
+    return basepair_band_[a * max_span_ + b - a - 1];    // only u<v-3, u<n-6 and proba > theta were kept
+}
+
+size_t MOIP::get_yuv_index(size_t u, size_t v) const
+{
+    size_t c = find_basepair(u, v);
+    if (c == basepairs_.size())
+        throw logic_error("(" + to_string(u) + "," + to_string(v) + ") is not a candidate basepair, it has no variable");
+    return c;
+}
 
-    // Now create proper motifs with Motif class
-    for (vector<Component>& v : vresults) {
-        Motif temp_motif = Motif(v, path(descfile).stem().string());
-
-        // Check if the probabilities allow to keep this Motif:
-        bool unprobable = false;
-        if (!allowed_basepair(temp_motif.comp[0].pos.first, temp_motif.comp.back().pos.second))
-            unprobable = true;
-        for (size_t j = 0; j < temp_motif.comp.size() -1; j++)
-            if (!allowed_basepair(temp_motif.comp[j].pos.second, temp_motif.comp[j+1].pos.first))
-                unprobable = true;
-        if (unprobable) continue;
-
-        // Add it to the results vector
-        unique_lock<mutex> lock(posInsertionSites_access);
-        insertion_sites_.push_back(temp_motif);
-        lock.unlock();
+size_t MOIP::crossing_clique(uint uv, uint k, IloExpr& c) const
+{
+    // u < k < v: the pairs (w<=u,k) and (k,l>=v) all cross (u,v) or share a nucleotide with it, and they are pairwise
+    // exclusive as they share k. So at most one of them or (u,v) can be formed: one row forbids every crossing of (u,v) at k.
+    uint   u = basepairs_[uv].first, v = basepairs_[uv].second;
+    size_t n_crossing = 0;
+    for (uint kl : partners_[k]) {
+        uint l = partner(kl, k);
+        if (u < l and l < v) continue;    // nested in (u,v)
+        c += basepair_dv_[kl];
+        n_crossing++;
     }
+    if (n_crossing) c += basepair_dv_[uv];
+    return n_crossing;
+}
+
+size_t MOIP::get_Cpxi_index(size_t x_i, size_t i_on_j) const { return index_of_Cxip_[x_i][i_on_j]; }
+
+
+
+void MOIP::remove_solution(ParetoArchive::const_iterator x) { pareto_.erase(x); }
+
+
+
+bool MOIP::allowed_basepair(size_t u, size_t v) const { return find_basepair(u, v) != basepairs_.size(); }
+
+void MOIP::allowed_motifs_from_desc(args_of_parallel_func arg_struct)
+{
+    /*
+        Searches where to place some DESC module in the RNA
+        Too short components are placed as 3 nucleotides windows, in all possible directions (see read_desc_template()).
+    */
+    const MotifTemplate& desc = arg_struct.motif;
+
+    // Join the positions of the components into placements of the whole motif, for every variant.
+    // The junctions between components must be able to pair, and so must the ends of the motif:
+    // check them as soon as the components are placed.
+    auto admissible = [&](const vector<Component>& v, size_t d) {
+        if (d and !allowed_basepair(v[d - 1].pos.second, v[d].pos.first)) return false;
+        if (d + 1 == v.size() and !allowed_basepair(v[0].pos.first, v[d].pos.second)) return false;
+        return true;
+    };
+    auto keep_placement = [&](const vector<Component>& v) {
+        // Now create a proper motif with Motif class and add it to the results vector
+        arg_struct.sites.push_back(Motif(v, desc.name));
+    };
+    for (const vector<uint>& c_s : desc.component_ids)
+        find_next_ones_in(arg_struct.hits, c_s, admissible, keep_placement);
 }
 
 void MOIP::allowed_motifs_from_rin(args_of_parallel_func arg_struct)
@@ -990,72 +1256,55 @@ void MOIP::allowed_motifs_from_rin(args_of_parallel_func arg_struct)
         Searches where to place some RINs in the RNA
     */
 
-    path           rinfile                  = arg_struct.motif_file;
-    mutex&         posInsertionSites_access = arg_struct.posInsertionSites_mutex;
-
-    std::ifstream                 motif;
-	string 	                      filepath = rinfile.string();
-    vector<vector<Component>>     vresults, r_vresults;
-    vector<string>                component_sequences;
-    uint                          carnaval_id;
-    string                        line, filenumber;
-    string                        rna = rna_.get_seq();
-    string                        reversed_rna = rna_.get_seq();
-
-    std::reverse(reversed_rna.begin(), reversed_rna.end());
-	filenumber = filepath.substr(filepath.find("Subfiles/")+9, filepath.find(".txt"));
-    carnaval_id = 1 + stoi(filenumber); // Start counting at 1 to be consistant with the website numbering
-
-    motif = std::ifstream(rinfile.string());
-    getline(motif, line); //skip the header_link line
-    getline(motif, line); //get the links line
-    getline(motif, line); //skip the header_comp line
-    while (getline(motif, line))
-    {
-        // lines are formatteed like:
-        // pos;k;seq
-        // 0,1;2;GU
-        if (line == "\n") break; //skip last line (empty)
-        size_t index = line.find(';', line.find(';') + 1); // find the second ';'
-        component_sequences.push_back(line.substr(index+1, string::npos)); // new component sequence
-    }
-
-    vresults     = find_next_ones_in(rna, 0, component_sequences);
-    r_vresults  = find_next_ones_in(reversed_rna, 0, component_sequences);
-
-    for (vector<Component>& v : vresults)
-    {
-        Motif temp_motif = Motif(v, rinfile, carnaval_id, false);
-
-		bool unprobable = false;
-		for (const Link& l : temp_motif.links_)
-		{
-			if (!allowed_basepair(l.nts.first,l.nts.second))
-				unprobable = true;
-		}
-		if (unprobable) continue;
-
-        // Add it to the results vector
-        unique_lock<mutex> lock(posInsertionSites_access);
-        insertion_sites_.push_back(temp_motif);
-        lock.unlock();
+    const MotifTemplate& rin = arg_struct.motif;
+    const vector<uint>&  vc  = rin.component_ids[0];
+
+    // Locate both nucleotides of every link in the components of the motif (like the c6 constraints do),
+    // the link is checked once the later of its two components is placed.
+    typedef struct { size_t comp_a, comp_b; uint offset_a, offset_b; } LinkEnds;
+    vector<vector<LinkEnds>> closed_links(vc.size());
+    for (const Link& l : rin.links) {
+        LinkEnds e;
+        size_t   found = 0;
+        uint     sum_comp_size = 0;
+        for (size_t j = 0; j < vc.size(); j++) {
+            uint k = arg_struct.hits.lengths[vc[j]];
+            if (sum_comp_size <= l.nts.first and l.nts.first < sum_comp_size + k) {
+                e.comp_a   = j;
+                e.offset_a = l.nts.first - sum_comp_size;
+                found++;
+            }
+            if (sum_comp_size <= l.nts.second and l.nts.second < sum_comp_size + k) {
+                e.comp_b   = j;
+                e.offset_b = l.nts.second - sum_comp_size;
+                found++;
+            }
+            sum_comp_size += k;
+        }
+        if (found == 2) closed_links[max(e.comp_a, e.comp_b)].push_back(e);
     }
 
-    for (vector<Component>& v : r_vresults)
-    {
-        Motif temp_motif = Motif(v, rinfile, carnaval_id, true);
-
-		bool unprobable = false;
-		for (const Link& l : temp_motif.links_)
-		{
-			if (!allowed_basepair(l.nts.first,l.nts.second))
-				unprobable = true;
-		}
-		if (unprobable) continue;
-
-        // Add it to the results vector
-        unique_lock<mutex> lock(posInsertionSites_access);
-        insertion_sites_.push_back(temp_motif);
-        lock.unlock();
-    }
+    // The placements found in the reversed RNA are checked and kept in the coordinates of the RNA
+    bool   reversed = false;
+    size_t n        = arg_struct.hits.rna_length;
+    auto   admissible = [&](const vector<Component>& v, size_t d) {
+        for (const LinkEnds& e : closed_links[d]) {
+            size_t a = v[e.comp_a].pos.first + e.offset_a;
+            size_t b = v[e.comp_b].pos.first + e.offset_b;
+            if (reversed) {
+                a = n - 1 - a;
+                b = n - 1 - b;
+            }
+            if (!allowed_basepair(min(a, b), max(a, b))) return false;
+        }
+        return true;
+    };
+    auto keep_placement = [&](const vector<Component>& v) {
+        // Create a proper motif with Motif class and add it to the results vector
+        arg_struct.sites.push_back(Motif(v, rin, reversed, n));
+    };
+
+    find_next_ones_in(arg_struct.hits, vc, admissible, keep_placement);
+    reversed = true;
+    find_next_ones_in(arg_struct.reversed_hits, vc, admissible, keep_placement);
 }
\ No newline at end of file
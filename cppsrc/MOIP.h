@@ -3,17 +3,29 @@
 
 #define IL_STD
 
+#include "MotifLibrary.h"
+#include "ParetoArchive.h"
 #include "SecondaryStructure.h"
 #include "rna.h"
 #include <ilconcert/ilomodel.h>
 #include <ilcplex/ilocplex.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 
+using std::shared_ptr;
 using std::vector;
 
 typedef struct args_ {
-						path           motif_file;
-						std::mutex&    posInsertionSites_mutex;
-						args_(path motif_file_, mutex& mutex_) : motif_file(motif_file_), posInsertionSites_mutex(mutex_) {}
+						const MotifTemplate& motif;
+						const ComponentHits& hits;             // where the components of the library match the RNA
+						const ComponentHits& reversed_hits;    // where the components of the library match the reversed RNA
+						vector<Motif>&       sites;                // where to store the insertion sites of this motif
+						args_(const MotifTemplate& motif_, const ComponentHits& hits_, const ComponentHits& reversed_hits_, vector<Motif>& sites_)
+						: motif(motif_), hits(hits_), reversed_hits(reversed_hits_), sites(sites_) {}
 					  } args_of_parallel_func;
 
 
@@ -21,43 +33,96 @@ class MOIP
 {
 	public:
 	MOIP(void);
-	MOIP(const RNA& rna, string source, string source_path, float theta, bool verbose);
+	MOIP(shared_ptr<const RNA> rna, string source, string source_path, float theta, bool verbose);
+	MOIP(shared_ptr<const RNA> rna, const MotifLibrary& library, float theta, bool verbose, char obj_function = obj_function_nbr_);
 	~MOIP(void);
 	SecondaryStructure        	solve_objective(int o, double min, double max);
 	SecondaryStructure        	solve_objective(int o);
 	uint						get_n_candidates(void) const;
 	uint                      	get_n_solutions(void) const;
-	const SecondaryStructure& 	solution(uint i) const;
+	const ParetoArchive&      	get_pareto(void) const;    // the solutions, by decreasing objective 1
+	void                      	search_front(SecondaryStructure& best1, SecondaryStructure& best2);    // the whole front, depth-first, with one solver
 	void                      	search_between(double lambdaMin, double lambdaMax);
+	void                      	search_in_parallel(SecondaryStructure& best1, SecondaryStructure& best2);    // the whole front, with n_solvers_ solvers
 	bool                      	allowed_basepair(size_t u, size_t v) const;
 	void                      	add_solution(const SecondaryStructure& s);
-	void                      	remove_solution(uint i);
+	void                      	remove_solution(ParetoArchive::const_iterator x);
 	void                      	forbid_solutions_between(double min, double max);
 	IloEnv&                   	get_env(void);
+	void                      	set_solution_callback(std::function<void(const SecondaryStructure&)> f);    // called for every structure entering the Pareto set
+	void                      	set_job(uint job);    // which of the n_jobs_ concurrent jobs solves this problem
+	uint                      	get_status(void) const;
+	string                    	status_string(void) const;
+	enum { COMPLETE = 0, TIME_LIMIT = 1, SOLVE_TIME_LIMIT = 2, SOLUTION_LIMIT = 4 };    // status flags: the budgets which cut the search
 	static char               	obj_function_nbr_;    // On what criteria do you want to insert motifs ?
 	static uint               	obj_to_solve_;  // What objective do you prefer to solve in mono-objective portions of the algorithm ?
 	static double             	precision_;   // decimals to keep in objective values, to avoid numerical issues. otherwise, solution with objective 5.0000000009 dominates solution with 5.0 =(
 	static bool               	allow_pk_;      // Wether we forbid pseudoknots (false) or allow them (true)
+	static char               	pk_formulation_;    // How to forbid them: pairwise rows (A) or clique rows (B)
 	static uint               	max_sol_nbr_;  // Number of solutions to accept in the Pareto set before we give up the computation
+	static string             	export_model_;    // File where to export the models before solving them (with named variables), if not empty
+	static uint               	n_solvers_;    // Number of solvers exploring the Pareto front concurrently in search_in_parallel()
+	static uint               	n_jobs_;    // Number of problems solved concurrently by the process, sharing its CPUs
+	static double             	time_limit_;    // Wall-clock budget of the whole search of a sequence, in seconds (0: none)
+	static double             	solve_time_limit_;    // Budget of a single CPLEX solve, in seconds (0: none)
+	static string             	checkpoint_dir_;    // Folder where to save the state of the searches, if not empty
+	static double             	checkpoint_interval_;    // Seconds between two checkpoints of a search
+	static bool               	resume_;    // Whether to start from the checkpoint of the same problem, if there is one
 	
 	private:
-	bool   						is_undominated_yet(const SecondaryStructure& s);
+	typedef struct {
+		int    o;           // objective to maximize
+		double min, max;    // bounds of the other one
+	} Interval;
+
+	std::unique_ptr<MOIP>		replica(uint solver, uint cplex_threads) const;    // Another solver of the same problem, in its own CPLEX environment
+	string 						export_path(void) const;    // export_model_, tagged with the job and solver when several of them run
+	SecondaryStructure			solve_objective(int o, double min, double max, bool verbose);
+	bool   						insert_in_pareto(const SecondaryStructure& s);    // false if s is dominated
+	bool   						out_of_budget(void);    // whether the search must stop now, because of the time or solution budgets
+	double 						elapsed(void) const;    // seconds since this problem was created
+	void   						explore_pending(void);
+	uint64_t					checkpoint_key(void) const;    // FNV-1a hash of the sequence, the model and the search parameters
+	string 						checkpoint_path(void) const;
+	void   						save_checkpoint(const std::deque<Interval>& pending, const ParetoArchive& pareto, const std::deque<SecondaryStructure>& found);
+	bool   						checkpoint_due(void);    // whether checkpoint_interval_ has passed since the last one, then restarts the count
+	bool   						load_checkpoint(void);    // restores pareto_, pending_ and found_, and forbids found_ in the model
+	void   						end_checkpoints(void);    // saves the state of an interrupted search, or removes that of a complete one
+	void   						forbid(const SecondaryStructure& s);
+	void   						define_basepair_variables(float theta);
+	void   						search_insertion_sites(const MotifLibrary& library, float theta);
+	void   						define_model(string source);
 	void   						define_problem_constraints(string& source);
-	size_t 						get_yuv_index(size_t u, size_t v) const;
+	size_t 						find_basepair(size_t u, size_t v) const;    // index of (u,v) in basepairs_, basepairs_.size() if it is not a candidate
+	size_t 						get_yuv_index(size_t u, size_t v) const;    // index of y^u_v, throws if (u,v) is not a candidate
+	uint   						partner(uint c, uint u) const;    // The other end of candidate basepair c, which involves u
+	size_t 						crossing_clique(uint uv, uint k, IloExpr& c) const;    // adds to c y(u,v) and the pairs of k crossing (u,v)
 	size_t 						get_Cpxi_index(size_t x_i, size_t i_on_j) const;
 	IloNumExprArg& 				y(size_t u, size_t v);    // Direct reference to y^u_v in basepair_dv_
 	IloNumExprArg& 				C(size_t x, size_t i);    // Direct reference to C_p^xi in insertion_dv_
-	bool   						exists_vertical_outdated_labels(const SecondaryStructure& s) const;
-	bool   						exists_horizontal_outdated_labels(const SecondaryStructure& s) const;
 	void   						allowed_motifs_from_desc(args_of_parallel_func arg_struct);
 	void   						allowed_motifs_from_rin(args_of_parallel_func arg_struct);
 	
-	bool verbose_;    // Should we print things ?
+	bool   verbose_;         // Should we print things ?
+	char   obj_function_;    // On what criteria do we insert motifs in this problem ?
+	float  theta_;           // Pairing probability threshold of the candidate basepairs
+	string source_;          // Kind of motif library
+	uint   cplex_threads_ = 0;    // Threads of CPLEX, 0 to let it decide
+	uint   job_ = 0;              // Index of the job solving this problem, among n_jobs_
+	uint   solver_ = 0;           // Index of this solver in search_in_parallel(), 0 for the MOIP which owns the search
+	std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();    // the time budget counts from here
+	std::atomic<uint>                     status_{ COMPLETE };    // budgets exhausted so far, set by any solver
+	bool                                  cut_short_ = false;    // whether the last solve was stopped by a time limit
+	std::function<void(const SecondaryStructure&)> on_solution_;    // streams the solutions out, if set
+	std::chrono::steady_clock::time_point last_checkpoint_ = start_;
 
 	// Elements of the problem
-	RNA                        rna_;                // RNA object
+	shared_ptr<const RNA>      rna_;                // RNA object, shared with the SecondaryStructures
 	vector<Motif>              insertion_sites_;    // Potential Motif insertion sites
-	vector<SecondaryStructure> pareto_;             // Vector of results
+	ParetoArchive              pareto_{ precision_ };    // Results, by decreasing objective 1
+	std::deque<Interval>       pending_;            // Intervals of the objective space left to explore
+	std::deque<Interval>       unexplored_;         // Intervals whose solve was cut short without a solution, saved for a resumed search
+	std::deque<SecondaryStructure> found_;          // Every solution found, hence forbidden in the model
 
 	// CPLEX objects
 	IloEnv                 env_;                         // environment CPLEX object
@@ -66,17 +131,31 @@ class MOIP
 	IloModel               model_;                       // Solver for objective 1
 	IloExpr                obj1;                         // Objective function that counts inserted motifs
 	IloExpr                obj2;                         // Objective function of expected accuracy
+	IloObjective           objective_;                   // Maximizes obj1 or obj2, whichever objective_nbr_ says
+	int                    objective_nbr_;
+	IloRange               bounds_[2];                   // min <= obj1 <= max and min <= obj2 <= max, relaxed on the maximized one
+	IloNumVarArray         all_dv_;                      // basepair_dv_ then insertion_dv_, to read solutions and pass MIP starts
+	IloCplex               cplex_;                       // Solver, extracted once and kept across the solves of the Pareto search
 	vector<vector<size_t>> index_of_Cxip_;               // Stores the indexes of the Cxip in insertion_dv_
 	vector<size_t>         index_of_first_components;    // Stores the indexes of Cx1p in insertion_dv_
-	vector<vector<size_t>> index_of_yuv_;                // Stores the indexes of the y^u_v in basepair_dv_
+	vector<pair<uint, uint>> basepairs_;                 // Candidate basepairs (u,v), u<v, in the order of their y^u_v in basepair_dv_
+	vector<uint>             first_basepair_;            // The pairs (u,v>u) are basepairs_[first_basepair_[u]] to basepairs_[first_basepair_[u+1]-1]
+	vector<vector<uint>>     partners_;                  // partners_[u]: indexes in basepairs_ of the pairs involving u, by increasing partner
+	uint                     max_span_ = 0;              // Largest v-u of the candidate basepairs
+	vector<uint>             basepair_band_;             // basepair_band_[u*max_span_ + v-u-1]: index of (u,v) in basepairs_, basepairs_.size() if not a candidate
 };
 
 inline uint                      MOIP::get_n_solutions(void) const { return pareto_.size(); }
 inline uint                      MOIP::get_n_candidates(void) const { return insertion_sites_.size(); }
-inline const SecondaryStructure& MOIP::solution(uint i) const { return pareto_[i]; }
+inline const ParetoArchive&      MOIP::get_pareto(void) const { return pareto_; }
 inline IloNumExprArg&            MOIP::y(size_t u, size_t v) { return basepair_dv_[get_yuv_index(u, v)]; }
+inline uint                      MOIP::partner(uint c, uint u) const { return (basepairs_[c].first == u) ? basepairs_[c].second : basepairs_[c].first; }
 inline IloNumExprArg&            MOIP::C(size_t x, size_t i) { return insertion_dv_[get_Cpxi_index(x, i)]; }
-inline SecondaryStructure        MOIP::solve_objective(int o) { return solve_objective(o, 0, rna_.get_RNA_length()); }
+inline SecondaryStructure        MOIP::solve_objective(int o, double min, double max) { return solve_objective(o, min, max, verbose_); }
+inline SecondaryStructure        MOIP::solve_objective(int o) { return solve_objective(o, 0, rna_->get_RNA_length()); }
 inline IloEnv&                   MOIP::get_env(void) { return env_; }
+inline uint                      MOIP::get_status(void) const { return status_; }
+inline void                      MOIP::set_solution_callback(std::function<void(const SecondaryStructure&)> f) { on_solution_ = f; }
+inline void                      MOIP::set_job(uint job) { job_ = job; }
 
 #endif    // MOIP_H_
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "Motif.h"
 #include "Pool.h"
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <iostream>
-#include <regex>
 #include <sstream>
+#include <stdexcept>
 #include <thread>
 
 using namespace boost::filesystem;
@@ -24,6 +25,44 @@ Motif::Motif(void) {}
 
 
 
+vector<Link> parse_links(string line)
+{
+    // Reads the links line of a RIN file, formatted like 0,5,False;1,4,False;
+    vector<Link> links;
+    string       link_str;
+    size_t       index = 0;
+    string       nt_str;
+    size_t       sub_index = 0;
+
+    while (line != "")
+    {
+        Link link;
+
+        //link.nts
+        index         = line.find(";");
+        link_str     = line.substr(0, index);
+        line.erase(0, index+1);
+
+        sub_index     = link_str.find(",");
+        nt_str         = link_str.substr(0, sub_index);
+        link_str.erase(0, sub_index+1);
+        link.nts.first = stoi(nt_str);
+
+        sub_index     = link_str.find(",");
+        nt_str         = link_str.substr(0, sub_index);
+        link_str.erase(0, sub_index+1);
+        link.nts.second = stoi(nt_str);
+
+        //link.long_range
+        link.long_range = (link_str == "True");
+
+        links.push_back(link);
+    }
+    return links;
+}
+
+
+
 Motif::Motif(const vector<Component>& v, string PDB) : comp(v), PDBID(PDB)
 {
     is_model_ = false;
@@ -82,86 +121,23 @@ Motif::Motif(string csv_line)
     }
 }
 
-Motif::Motif(const vector<Component>& v, path rinfile, uint id, bool reversed) : comp(v), reversed_(reversed)
+Motif::Motif(const vector<Component>& v, const MotifTemplate& rin, bool reversed, size_t rna_length)
+    : comp(v), links_(rin.links), reversed_(reversed)
 {
-    // Loads a motif from the RIN file of Carnaval
-    carnaval_id = to_string(id);
+    // A placement of a CaRNAval RIN, whose file has already been read by read_rin_template().
+    // A placement found in the reversed RNA is stored in the coordinates of the RNA, like the others: its components
+    // come in the reverse order, and each of them holds its template sequence backwards.
+    carnaval_id = to_string(rin.carnaval_id);
     source_     = CARNAVAL;
-    is_model_     = false;
-
-    std::ifstream file(rinfile);
-
-    if (file.is_open())
-    {
-        string line;
-
-        getline(file,line); //skip the header_link line
-        getline(file,line); //get the links line
-        string link_str;
-        size_t index = 0;
-        string nt_str;
-        size_t sub_index = 0;
-
-        while (line != "")
-        {
-            Link link;
-
-            //link.nts
-            index         = line.find(";");
-            link_str     = line.substr(0, index);
-            line.erase(0, index+1);
-
-            sub_index     = link_str.find(",");
-            nt_str         = link_str.substr(0, sub_index);
-            link_str.erase(0, sub_index+1);
-            link.nts.first = stoi(nt_str);
-
-            sub_index     = link_str.find(",");
-            nt_str         = link_str.substr(0, sub_index);
-            link_str.erase(0, sub_index+1);
-            link.nts.second = stoi(nt_str);
-
-            //link.long_range
-            link.long_range = (link_str == "True");
-
-            links_.push_back(link);
-        }
-
-
-        getline(file,line); //skip the header_comp line
-        string pos_str, sub_pos_str, k_str, seq;
-
-        while ( std::getline(file,line) )
-        {
-            if (line == "\n") break; //skip last line (empty)
-
-            Component c(0,0);
-
-            //c.pos
-            index         = line.find(";");
-            pos_str     = line.substr(0, index);
-            line.erase(0, index+1);
-
-            sub_index     = pos_str.find(",");
-            sub_pos_str = pos_str.substr(0, sub_index);
-            pos_str.erase(0, sub_index+1);
-            c.pos.first = stoi(sub_pos_str);
-            c.pos.second = stoi(pos_str);
-
-            //c.k
-            index     = line.find(";");
-            k_str     = line.substr(0, index);
-            line.erase(0, index+1);
-            c.k     = stoi(k_str);
-
-            //c.seq_
-            c.seq_ = line;
-
-            comp.push_back(c);
-        }
+    is_model_   = false;
+    if (reversed) {
+        std::reverse(comp.begin(), comp.end());
+        for (Component& c : comp) c.pos = make_pair(uint(rna_length - 1 - c.pos.second), uint(rna_length - 1 - c.pos.first));
+    }
+    for (size_t t = 0; t < comp.size() and t < rin.variants[0].size(); t++) {
+        comp[comp_index(t)].seq_ = rin.variants[0][t];
+        if (reversed) std::reverse(comp[comp_index(t)].seq_.begin(), comp[comp_index(t)].seq_.end());
     }
-
-    else cout << "\t> RIN file not found : " << rinfile << endl;
 }
 
 string Motif::pos_string(void) const
@@ -173,6 +149,20 @@ string Motif::pos_string(void) const
     return s.str();
 }
 
+size_t Motif::comp_index(size_t t) const { return reversed_ ? comp.size() - 1 - t : t; }
+
+size_t Motif::nt_position(uint nt) const
+{
+    // Links number the nucleotides of the RIN along its components, as if they were contiguous.
+    // A reversed placement reads them from the end of the RNA.
+    for (size_t t = 0; t < comp.size(); t++) {
+        const Component& c = comp[comp_index(t)];
+        if (nt < c.k) return reversed_ ? c.pos.second - nt : c.pos.first + nt;
+        nt -= c.k;
+    }
+    return size_t(-1);
+}
+
 string Motif::get_identifier(void) const
 {
     switch (source_) {
@@ -200,6 +190,7 @@ char Motif::is_valid_DESC(const string& descfile)
         *prev    = c;
         return (c == ' ' and res);
     });    // get a vector of 866_G, 867_G, etc...
+    if (bases.size() < 3) throw runtime_error(descfile + " has no Bases line");
 
     for (vector<string>::iterator b = (bases.begin() + 1); b != (bases.end() - 1); b++) {
         char nt  = b->substr(b->find('_') + 1, 1).back();
@@ -255,17 +246,27 @@ char Motif::is_valid_RIN(const string& rinfile)
     return (char) 0;
 }
 
-bool is_desc_insertible(const string& descfile, const string& rna)
+MotifTemplate read_desc_template(const path& descfile)
 {
+    /*
+        Reads a DESC module once, and keeps what is needed to place it in any RNA:
+        the pattern of the whole motif, and the patterns of its components.
+    */
+    MotifTemplate  t;
     std::ifstream  motif;
     string         line;
     string         seq;
+    vector<string> component_sequences;
     vector<string> bases;
     int            last;
     char           c    = 'a';
     char*          prev = &c;
 
-    motif = std::ifstream(descfile);
+    t.file        = descfile;
+    t.name        = descfile.stem().string();
+    t.carnaval_id = 0;
+
+    motif = std::ifstream(descfile.string());
     getline(motif, line);    // ignore "id: number"
     getline(motif, line);    // Bases: 866_G  867_G  868_G  869_G  870_U  871_A ...
     boost::split(bases, line, [prev](char c) {
@@ -274,6 +275,7 @@ bool is_desc_insertible(const string& descfile, const string& rna)
         return (c == ' ' and res);
     });    // get a vector of 866_G, 867_G, etc...
 
+    // The regular expression of the whole motif
     seq  = "";
     last = stoi(bases[1].substr(0, bases[1].find('_')));
     for (vector<string>::iterator b = (bases.begin() + 1); b != (bases.end() - 1); b++) {
@@ -294,76 +296,148 @@ bool is_desc_insertible(const string& descfile, const string& rna)
         seq += nt;    // pos - last == 1 in particular
         last = pos;
     }
-    smatch m;
-    regex  e(seq);
+    t.pattern = seq;
 
-    return regex_search(rna, m, e);
+    // The sequences of the components
+    seq  = "";
+    last = stoi(bases[1].substr(0, bases[1].find('_')));
+    for (vector<string>::iterator b = bases.begin() + 1; b != bases.end() - 1; b++) {
+        char nt  = b->substr(b->find('_') + 1, 1).back();
+        int  pos = stoi(b->substr(0, b->find('_')));
 
+        if (pos - last > 5) {    // finish this component and start a new one
+            component_sequences.push_back(seq);
+            seq = "";
+        } else if (pos - last == 2) {
+            seq += '.';
+        } else if (pos - last == 3) {
+            seq += "..";
+        } else if (pos - last == 4) {
+            seq += "...";
+        } else if (pos - last == 5) {
+            seq += "....";
+        }
+        seq += nt;
+        last = pos;
+    }
+    component_sequences.push_back(seq);
+    // Now component_sequences is a vector of sequences like {AGCGC, CGU..GUUU}
+
+    // Components of length 1 or 2 are extended to length 3, in any direction
+    for (string& c : component_sequences)
+        if (c.length() < 3) c += "~3";
+    t.variants.push_back(component_sequences);
+    return t;
 }
 
-vector<vector<Component>> find_next_ones_in(string rna, uint offset, vector<string>& vc)
+MotifTemplate read_rin_template(const path& rinfile)
 {
-    pair<uint, uint>          pos;
-    vector<vector<Component>> results;
-    vector<vector<Component>> next_ones;
-    vector<string>            next_seqs;
-    regex                     c(vc[0]);
-
-    //cout << "\t\t>Searching " << vc[0] << " in " << rna << endl;
+    /*
+        Reads a CaRNAval RIN once, and keeps the sequences of its components.
+    */
+    MotifTemplate t;
+    std::ifstream motif;
+    string        filepath = rinfile.string();
+    string        line, filenumber;
+
+    filenumber    = filepath.substr(filepath.find("Subfiles/") + 9, filepath.find(".txt"));
+    t.file        = rinfile;
+    t.name        = rinfile.stem().string();
+    t.carnaval_id = 1 + stoi(filenumber);    // Start counting at 1 to be consistant with the website numbering
+    t.variants    = vector<vector<string>>(1);
+
+    motif = std::ifstream(filepath);
+    getline(motif, line);    // skip the header_link line
+    getline(motif, line);    // get the links line
+    t.links = parse_links(line);
+    getline(motif, line);    // skip the header_comp line
+    while (getline(motif, line)) {
+        // lines are formatteed like:
+        // pos;k;seq
+        // 0,1;2;GU
+        if (line == "\n") break;    // skip last line (empty)
+        size_t index = line.find(';', line.find(';') + 1);                    // find the second ';'
+        t.variants[0].push_back(line.substr(index + 1, string::npos));    // new component sequence
+    }
+    return t;
+}
 
-    if (vc.size() > 1) {
-        if (regex_search(rna, c)) {
-            if (vc.size() > 2)
-                next_seqs = vector<string>(&vc[1], &vc[vc.size()]);
+bool is_desc_insertible(const MotifTemplate& desc, const ComponentHits& hits)
+{
+    // Wether the whole motif matches the RNA, placing every segment at its leftmost possible position
+    uint from = 0;
+    for (size_t k = 0; k < desc.segment_ids.size(); k++) {
+        const vector<uint>&          starts = hits.starts[desc.segment_ids[k]];
+        vector<uint>::const_iterator pos    = lower_bound(starts.begin(), starts.end(), from);
+        if (pos == starts.end()) return false;
+        from = *pos + hits.lengths[desc.segment_ids[k]];
+        if (k < desc.segment_gaps.size()) from += desc.segment_gaps[k];
+    }
+    return true;
+}
 
-            else
-                next_seqs = vector<string>(1, vc.back());
-
-            // For every regexp match
-            for (sregex_iterator i = sregex_iterator(rna.begin(), rna.end(), c); i != sregex_iterator(); ++i) {
-                smatch match = *i;
-                pos.first    = match.position() + offset;
-                pos.second   = pos.first + match.length() - 1;
-                // cout << "\t\t>Inserting " << vc[0] << " in [" << pos.first << ',' << pos.second << "]" << endl;
-                if (pos.second - offset + 5 >= rna.length()) {
-                    // cout << "\t\t... but we cannot place the next components : Ignored." << endl;
-                    continue;
-                }
-                next_ones = find_next_ones_in(rna.substr(pos.second - offset + 5), pos.second + 5, next_seqs);
-                if (!next_ones.size()) {
-                    // cout << "\t\t... but we cannot place the next components : Ignored." << endl;
-                    continue;
-                }
-                // cout  << endl;
-                for (vector<Component> v : next_ones)    // For every combination of the next components
-                {
-                    // Combine the match for this component pos with the combination
-                    // of next_ones as a whole solution
-                    vector<Component> r;
-                    r.push_back(Component(pos));
-                    for (Component& c : v) r.push_back(c);
-                    results.push_back(r);
-                }
+void find_next_ones_in(const ComponentHits& hits, const vector<uint>& vc,
+                       const function<bool(const vector<Component>&, size_t)>& admissible,
+                       const function<void(const vector<Component>&)>&         emit)
+{
+    // Places the components vc[0], vc[1], ... in the RNA, every component at least 4 nucleotides after the previous one,
+    // and passes every complete placement to emit(). The placement buffer is reused, emit() must copy what it keeps.
+    // Like successive regular expression searches, the placements of one component do not overlap, and start from
+    // the leftmost match after the previous component. An extended component 'X~n' stands for its variants, X at every
+    // offset in a window of n nucleotides ('G..', '.G.', '..G'): its placements are the union of those of its
+    // variants, each window once.
+    // Once component d is placed, admissible(placement, d) is asked whether the components 0..d can still be part
+    // of a valid placement, the rejected branches are not explored further.
+    size_t k = vc.size();
+    if (!k) return;
+
+    vector<Component>    placement(k, Component(0, 0));
+    vector<vector<uint>> candidates(k);    // explicit stack: where every component can start, given the previous ones
+    vector<size_t>       next(k);          // index of the next candidate to try, for every component
+
+    auto place_from = [&](size_t d, uint from) {
+        const vector<uint>& matches = hits.starts[vc[d]];
+        uint                length  = hits.lengths[vc[d]];
+        uint                slack   = hits.slacks[vc[d]];
+        candidates[d].clear();
+        next[d] = 0;
+        for (uint offset = 0; offset <= slack; offset++) {
+            // one variant: its leftmost placement at or after from, then the leftmost one after it, etc.
+            vector<uint>::const_iterator m = lower_bound(matches.begin(), matches.end(), from + offset);
+            while (m != matches.end() and *m - offset + length <= hits.rna_length) {
+                candidates[d].push_back(*m - offset);
+                m = lower_bound(m, matches.end(), *m + length);
             }
         }
-    } else {
-        // Only one more component to find
-
-        if (regex_search(rna, c)) {
-            // For each regexp match
-            for (sregex_iterator i = sregex_iterator(rna.begin(), rna.end(), c); i != sregex_iterator(); ++i) {
-                smatch match = *i;
-                pos.first    = match.position() + offset;
-                pos.second   = pos.first + match.length() - 1;
-
-                // Create a vector of component with one component for that match
-                vector<Component> r;
-                r.push_back(Component(pos));
-                results.push_back(r);
-            }
+        if (slack) {
+            sort(candidates[d].begin(), candidates[d].end());
+            candidates[d].erase(unique(candidates[d].begin(), candidates[d].end()), candidates[d].end());
         }
+    };
+
+    size_t d = 0;
+    place_from(0, 0);
+    for (;;) {
+        if (next[d] == candidates[d].size()) {
+            // no more placements for this component, backtrack to the previous one
+            if (!d) return;
+            d--;
+            continue;
+        }
+
+        uint start              = candidates[d][next[d]++];
+        placement[d].pos.first  = start;
+        placement[d].pos.second = start + hits.lengths[vc[d]] - 1;
+        placement[d].k          = hits.lengths[vc[d]];
+
+        if (not admissible(placement, d)) continue;
+        if (d + 1 < k) {
+            // go deeper: the next component starts at least 4 nucleotides after this one
+            place_from(d + 1, placement[d].pos.second + 5);
+            d++;
+        } else
+            emit(placement);
     }
-    return results;
 }
 
 bool operator==(const Component& c1, const Component& c2)
@@ -2,6 +2,7 @@
 #define MOTIF_H_
 
 #include <boost/filesystem.hpp>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -13,6 +14,7 @@ using std::pair;
 using std::string;
 using std::vector;
 using std::mutex;
+using std::function;
 
 
 
@@ -38,22 +40,49 @@ typedef struct Link
 
 
 
+typedef struct MotifTemplate_ {
+    path                   file;           // DESC or RIN file the template has been read from
+    string                 name;           // DESC file stem
+    uint                   carnaval_id;    // if the template is a CaRNAval RIN
+    string                 pattern;        // DESC: regular expression of the whole motif, to quickly test if it can be inserted
+    vector<vector<string>> variants;       // component sequences (as GappedPattern), one vector per variant of the motif
+    vector<Link>           links;          // RIN: basepairs between the nucleotides of the motif
+
+    vector<uint>           segment_ids;       // DESC: ids of the segments of pattern in the library's MotifScanner
+    vector<uint>           segment_gaps;      // DESC: minimal number of nucleotides between the segments of pattern
+    vector<vector<uint>>   component_ids;     // ids of the component sequences in the library's MotifScanner, one vector per variant
+} MotifTemplate;
+
+
+
+typedef struct ComponentHits_ {
+    vector<vector<uint>> starts;        // starts[id]: sorted positions where the component pattern id matches the RNA
+                                        // (for an extended pattern 'X~n', where its core X matches)
+    vector<uint>         lengths;       // lengths[id]: length of a placement of the component pattern id
+    vector<uint>         slacks;        // slacks[id]: n - |X| for an extended pattern, the offsets of X in its window, else 0
+    size_t               rna_length;
+} ComponentHits;
+
+
+
 class Motif
 {
     public:
     Motif(void);
     Motif(string csv_line);
     Motif(const vector<Component>& v, string PDB);
-    Motif(const vector<Component>& v, path rinfile, uint id, bool reversed);
+    Motif(const vector<Component>& v, const MotifTemplate& rin, bool reversed, size_t rna_length);
     Motif(string path, int id); //full path to biorseo/data/modules/RIN/Subfiles/
     static char       is_valid_RIN(const string& rinfile);
     static char       is_valid_DESC(const string& descfile);
     string            pos_string(void) const;
     string            get_origin(void) const;
     string            get_identifier(void) const;
+    size_t            nt_position(uint nt) const;    // where the nt-th nucleotide of a RIN link is placed, -1 if beyond the components
+    size_t            comp_index(size_t t) const;    // index in comp of the t-th component of a RIN
     vector<Component> comp;
     vector<Link>      links_;
-    double            score_;
+    double            score_ = 0;    // JAR3D or BayesPairing score, none for the other sources
     bool              reversed_;
 
     private:
@@ -64,12 +93,16 @@ class Motif
     enum { RNA3DMOTIF = 1, RNAMOTIFATLAS = 2, CARNAVAL = 3 } source_;
 };
 
-bool                        is_desc_insertible(const string& descfile, const string& rna);
+MotifTemplate               read_desc_template(const path& descfile);
+MotifTemplate               read_rin_template(const path& rinfile);
+bool                        is_desc_insertible(const MotifTemplate& desc, const ComponentHits& hits);
 bool                        is_rin_insertible(const string& rinfile, const string& rna);
 vector<Motif>               load_txt_folder(const string& path, const string& rna, bool verbose);
 vector<Motif>               load_desc_folder(const string& path, const string& rna, bool verbose);
 vector<Motif>               load_csv(const string& path);
-vector<vector<Component>>   find_next_ones_in(string rna, uint offset, vector<string>& vc);
+void                        find_next_ones_in(const ComponentHits& hits, const vector<uint>& vc,
+                                              const function<bool(const vector<Component>&, size_t)>& admissible,
+                                              const function<void(const vector<Component>&)>&         emit);
 
 // utilities to compare secondary structures:
 bool operator==(const Motif& m1, const Motif& m2);
@@ -0,0 +1,456 @@
+#include "MotifLibrary.h"
+#include "BoundedQueue.h"
+#include "Pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+
+using namespace boost::filesystem;
+using namespace std;
+
+
+struct recursive_directory_range {
+    typedef recursive_directory_iterator iterator;
+    recursive_directory_range(path p) : p_(p) {}
+
+    iterator begin() { return recursive_directory_iterator(p_); }
+    iterator end() { return recursive_directory_iterator(); }
+
+    path p_;
+};
+
+static const char unreadable = '!';    // error of the motif files which could not be parsed at all
+
+/*
+    Binary index of a motif library, written by save_index() and read by load_index().
+    The file is a header followed by fixed-size tables, then by a blob containing the characters of every string:
+    header | entries | variants | components | links | ids | patterns | states | anchors | unanchored | blob
+    Entries are the motif files, valid or not (error != 0). Every string is an (offset, length) pair in the blob.
+    The tables also hold the library's MotifScanner as it was built: the scanner ids of every segment and component,
+    the distinct patterns, and the Aho-Corasick automaton (states and anchors). Loading the index thus skips the listing,
+    validation and text parsing of the motif files as well as the construction of the automaton: the templates are
+    copied out of the mapping, and only the distinct patterns are compiled again.
+*/
+
+static const char     index_magic[8] = {'B', 'i', 'O', 'R', 'S', 'E', 'O', 'x'};
+static const uint32_t index_version  = 3;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} IndexString;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t source;    // 1 for descfolder, 2 for rinfolder
+    uint64_t n_entries, n_variants, n_components, n_links, n_ids;
+    uint64_t n_patterns, n_states, n_anchors, n_unanchored, blob_size;
+} IndexHeader;
+
+typedef struct {
+    IndexString file, name, pattern;
+    uint32_t    carnaval_id;
+    uint32_t    first_variant, n_variants;
+    uint32_t    first_link, n_links;
+    uint32_t    first_segment, n_segments;    // segment_ids, in the ids table
+    uint32_t    first_gap, n_gaps;            // segment_gaps, in the ids table
+    char        error;
+    char        padding[3];
+} IndexEntry;
+
+typedef struct {
+    uint32_t first_component, n_components;
+} IndexVariant;
+
+typedef struct {
+    IndexString pattern;
+    uint32_t    id;    // in the scanner
+} IndexComponent;
+
+typedef struct {
+    uint32_t first, second;
+    uint32_t long_range;
+} IndexLink;
+
+typedef struct {
+    int32_t  transitions[4];
+    uint32_t first_anchor, n_anchors;
+} IndexState;
+
+typedef struct {
+    uint32_t id, offset;
+} IndexAnchor;
+
+MotifLibrary::MotifLibrary(void) : errors_(0) {}
+
+MotifLibrary::MotifLibrary(string source, string source_path, bool verbose) : source_(source), errors_(0)
+{
+    // Walks the DESC or RIN folder once, and keeps every valid motif in memory.
+    // A thread lists the folder while the threads of the pool validate and parse the files it found:
+    // the bounded queue between them keeps the listing from running far ahead of the parsing.
+
+    if (!exists(source_path)) {
+        cerr << "!!! Hmh, i can't find that folder: " << source_path << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (source != "descfolder" and source != "rinfolder") {
+        cout << "!!! Problem with the source" << endl;
+        return;
+    }
+
+    bool                               desc      = (source == "descfolder");
+    size_t                             n_readers = Pool::shared().size();
+    BoundedQueue<path>                 files(64 * n_readers);
+    vector<vector<MotifTemplate>>      read(n_readers);        // valid motifs found by every reader
+    vector<vector<pair<string, char>>> rejected(n_readers);    // invalid files found by every reader
+    exception_ptr                      listing_error;
+
+    thread lister([&]() {
+        try {
+            for (auto it : recursive_directory_range(source_path))
+                if (is_regular_file(it.path())) files.push(it.path());
+        } catch (...) {
+            listing_error = current_exception();
+        }
+        files.close();
+    });
+
+    auto read_files = [&](size_t r) {
+        path file;
+        while (files.pop(file)) {
+            // Keep the file iff it is valid. A file the parsers choke on is one more invalid file,
+            // the exception must not leave the pool thread.
+            try {
+                char error = desc ? Motif::is_valid_DESC(file.string()) : Motif::is_valid_RIN(file.string());
+                if (error)
+                    rejected[r].push_back(make_pair(file.string(), error));
+                else
+                    read[r].push_back(desc ? read_desc_template(file) : read_rin_template(file));
+            } catch (...) {
+                rejected[r].push_back(make_pair(file.string(), unreadable));
+            }
+        }
+    };
+    Pool::shared().parallel_for(n_readers, read_files);
+    lister.join();
+    if (listing_error) rethrow_exception(listing_error);
+
+    for (size_t r = 0; r < n_readers; r++) {
+        templates_.insert(templates_.end(), make_move_iterator(read[r].begin()), make_move_iterator(read[r].end()));
+        ignored_.insert(ignored_.end(), rejected[r].begin(), rejected[r].end());
+    }
+    errors_ = ignored_.size();
+
+    // The directory walk order depends on the filesystem, and the readers run concurrently:
+    // sort the motifs by id, so that runs are reproducible
+    sort(templates_.begin(), templates_.end(), [](const MotifTemplate& a, const MotifTemplate& b) {
+        return tie(a.carnaval_id, a.name, a.file) < tie(b.carnaval_id, b.name, b.file);
+    });
+    sort(ignored_.begin(), ignored_.end());
+
+    if (verbose)
+        for (const pair<string, char>& f : ignored_) {
+            if (f.second == unreadable) {
+                cerr << "\t>Ignoring " << path(f.first).stem() << ", the file could not be read.";
+            } else if (desc) {
+                cerr << "\t>Ignoring motif " << path(f.first).stem();
+                switch (f.second) {
+                case '-': cerr << ", some nucleotides have a negative number..."; break;
+                case 'l': cerr << ", hairpin (terminal) loops must be at least of size 3 !"; break;
+                case 'b': cerr << ", backbone link between non-consecutive residues ?"; break;
+                default: cerr << ", use of an unknown nucleotide " << f.second;
+                }
+            } else {
+                cerr << "\t>Ignoring RIN " << path(f.first).stem();
+                switch (f.second) {
+                case 'l': cerr << ", too short to be considered."; break;
+                case 'x': cerr << ", because not constraining the secondary structure."; break;
+                default: cerr << ", unknown reason";
+                }
+            }
+            cerr << endl;
+        }
+
+    index_patterns();
+
+    if (verbose)
+        cout << "\t> " << templates_.size() << " motifs loaded from " << source_path << " (" << errors_ << " ignored motifs)" << endl;
+}
+
+void MotifLibrary::index_patterns(void)
+{
+    // Gives every component pattern of the library an id in the scanner, and builds its automaton
+    scanner_ = MotifScanner();
+    for (MotifTemplate& t : templates_) {
+        GappedPattern whole(t.pattern);
+        t.segment_ids.clear();
+        t.segment_gaps = vector<uint>(whole.get_min_gaps().begin(), whole.get_min_gaps().end());
+        if (t.pattern.size())
+            for (const string& segment : whole.get_segments()) t.segment_ids.push_back(scanner_.add_pattern(segment));
+        t.component_ids.clear();
+        for (const vector<string>& v : t.variants) {
+            t.component_ids.push_back(vector<uint>());
+            for (const string& c : v) t.component_ids.back().push_back(scanner_.add_pattern(c));
+        }
+    }
+    scanner_.build();
+}
+
+void MotifLibrary::save_index(const string& index_path) const
+{
+    // Writes the library and its scanner in a single binary file, that load_index() reads back without opening or parsing the
+    // motif files
+
+    IndexHeader            header;
+    vector<IndexEntry>     entries;
+    vector<IndexVariant>   variants;
+    vector<IndexComponent> components;
+    vector<IndexLink>      links;
+    vector<uint32_t>       ids;
+    vector<IndexString>    patterns;
+    vector<IndexState>     states;
+    vector<IndexAnchor>    anchors;
+    vector<uint32_t>       unanchored(scanner_.unanchored_.begin(), scanner_.unanchored_.end());
+    string                 blob;
+
+    auto add_string = [&blob](const string& str) {
+        IndexString s = {static_cast<uint32_t>(blob.size()), static_cast<uint32_t>(str.size())};
+        blob += str;
+        return s;
+    };
+
+    for (const MotifTemplate& t : templates_) {
+        IndexEntry e;
+        memset(&e, 0, sizeof(e));
+        e.file          = add_string(t.file.string());
+        e.name          = add_string(t.name);
+        e.pattern       = add_string(t.pattern);
+        e.carnaval_id   = t.carnaval_id;
+        e.first_variant = variants.size();
+        e.n_variants    = t.variants.size();
+        e.first_link    = links.size();
+        e.n_links       = t.links.size();
+        e.first_segment = ids.size();
+        e.n_segments    = t.segment_ids.size();
+        ids.insert(ids.end(), t.segment_ids.begin(), t.segment_ids.end());
+        e.first_gap = ids.size();
+        e.n_gaps    = t.segment_gaps.size();
+        ids.insert(ids.end(), t.segment_gaps.begin(), t.segment_gaps.end());
+        for (size_t v = 0; v < t.variants.size(); v++) {
+            variants.push_back({static_cast<uint32_t>(components.size()), static_cast<uint32_t>(t.variants[v].size())});
+            for (size_t c = 0; c < t.variants[v].size(); c++)
+                components.push_back({add_string(t.variants[v][c]), t.component_ids[v][c]});
+        }
+        for (const Link& l : t.links) links.push_back({l.nts.first, l.nts.second, l.long_range});
+        entries.push_back(e);
+    }
+    for (const pair<string, char>& ignored : ignored_) {
+        IndexEntry e;
+        memset(&e, 0, sizeof(e));
+        e.file  = add_string(ignored.first);
+        e.name  = add_string(path(ignored.first).stem().string());
+        e.error = ignored.second;
+        entries.push_back(e);
+    }
+    for (const string& p : scanner_.sources_) patterns.push_back(add_string(p));
+    for (size_t q = 0; q < scanner_.transitions_.size(); q++) {
+        IndexState state;
+        for (int c = 0; c < 4; c++) state.transitions[c] = scanner_.transitions_[q][c];
+        state.first_anchor = anchors.size();
+        state.n_anchors    = scanner_.outputs_[q].size();
+        for (const MotifScanner::Anchor& a : scanner_.outputs_[q]) anchors.push_back({a.id, a.offset});
+        states.push_back(state);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.version      = index_version;
+    header.source       = (source_ == "descfolder") ? 1 : 2;
+    header.n_entries    = entries.size();
+    header.n_variants   = variants.size();
+    header.n_components = components.size();
+    header.n_links      = links.size();
+    header.n_ids        = ids.size();
+    header.n_patterns   = patterns.size();
+    header.n_states     = states.size();
+    header.n_anchors    = anchors.size();
+    header.n_unanchored = unanchored.size();
+    header.blob_size    = blob.size();
+
+    std::ofstream index(index_path, std::ios::binary);
+    index.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    index.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(IndexEntry));
+    index.write(reinterpret_cast<const char*>(variants.data()), variants.size() * sizeof(IndexVariant));
+    index.write(reinterpret_cast<const char*>(components.data()), components.size() * sizeof(IndexComponent));
+    index.write(reinterpret_cast<const char*>(links.data()), links.size() * sizeof(IndexLink));
+    index.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(uint32_t));
+    index.write(reinterpret_cast<const char*>(patterns.data()), patterns.size() * sizeof(IndexString));
+    index.write(reinterpret_cast<const char*>(states.data()), states.size() * sizeof(IndexState));
+    index.write(reinterpret_cast<const char*>(anchors.data()), anchors.size() * sizeof(IndexAnchor));
+    index.write(reinterpret_cast<const char*>(unanchored.data()), unanchored.size() * sizeof(uint32_t));
+    index.write(blob.data(), blob.size());
+    if (!index) {
+        cerr << "!!! Could not write the motif library index " << index_path << endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+static bool in_range(uint64_t first, uint64_t n, uint64_t size) { return first <= size and n <= size - first; }
+
+static bool tables_fit(const IndexHeader& h, size_t file_size)
+{
+    // Wether the tables announced by the header exactly fill the file, without overflowing on absurd counts
+    uint64_t left = file_size - sizeof(IndexHeader);
+    for (pair<uint64_t, size_t> table : {make_pair(h.n_entries, sizeof(IndexEntry)), make_pair(h.n_variants, sizeof(IndexVariant)),
+                                         make_pair(h.n_components, sizeof(IndexComponent)), make_pair(h.n_links, sizeof(IndexLink)),
+                                         make_pair(h.n_ids, sizeof(uint32_t)), make_pair(h.n_patterns, sizeof(IndexString)),
+                                         make_pair(h.n_states, sizeof(IndexState)), make_pair(h.n_anchors, sizeof(IndexAnchor)),
+                                         make_pair(h.n_unanchored, sizeof(uint32_t)), make_pair(h.blob_size, size_t(1))}) {
+        if (table.first > left / table.second) return false;
+        left -= table.first * table.second;
+    }
+    return left == 0;
+}
+
+MotifLibrary MotifLibrary::load_index(const string& index_path, bool verbose)
+{
+    // Maps a binary index written by save_index() in memory, checks every range it holds, then copies the templates and
+    // the scanner out of its tables and unmaps it. A truncated or corrupted index is an error, it is never read out of bounds.
+
+    MotifLibrary lib;
+    struct stat  st;
+    int          fd = open(index_path.c_str(), O_RDONLY);
+    if (fd < 0 or fstat(fd, &st) < 0 or static_cast<size_t>(st.st_size) < sizeof(IndexHeader)) {
+        cerr << "!!! Hmh, i can't read that motif library index: " << index_path << endl;
+        exit(EXIT_FAILURE);
+    }
+    size_t      size = st.st_size;
+    const char* data = static_cast<const char*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (data == MAP_FAILED) {
+        cerr << "!!! Could not map the motif library index " << index_path << " in memory" << endl;
+        exit(EXIT_FAILURE);
+    }
+    auto reject = [&](const string& reason) {
+        cerr << "!!! " << index_path << " " << reason << endl;
+        munmap(const_cast<char*>(data), size);
+        exit(EXIT_FAILURE);
+    };
+
+    const IndexHeader* header = reinterpret_cast<const IndexHeader*>(data);
+    if (memcmp(header->magic, index_magic, sizeof(index_magic)) or header->version != index_version)
+        reject("is not a motif library index compiled by this version of biorseo");
+    if (not tables_fit(*header, size)) reject("is truncated or corrupted: its tables do not match its size");
+    if (header->source != 1 and header->source != 2) reject("is corrupted: unknown motif source");
+
+    const IndexEntry*     entries    = reinterpret_cast<const IndexEntry*>(data + sizeof(IndexHeader));
+    const IndexVariant*   variants   = reinterpret_cast<const IndexVariant*>(entries + header->n_entries);
+    const IndexComponent* components = reinterpret_cast<const IndexComponent*>(variants + header->n_variants);
+    const IndexLink*      links      = reinterpret_cast<const IndexLink*>(components + header->n_components);
+    const uint32_t*       ids        = reinterpret_cast<const uint32_t*>(links + header->n_links);
+    const IndexString*    patterns   = reinterpret_cast<const IndexString*>(ids + header->n_ids);
+    const IndexState*     states     = reinterpret_cast<const IndexState*>(patterns + header->n_patterns);
+    const IndexAnchor*    anchors    = reinterpret_cast<const IndexAnchor*>(states + header->n_states);
+    const uint32_t*       unanchored = reinterpret_cast<const uint32_t*>(anchors + header->n_anchors);
+    const char*           blob       = reinterpret_cast<const char*>(unanchored + header->n_unanchored);
+
+    // Check every range and every scanner id before anything is dereferenced through them
+    auto valid_string = [header](const IndexString& s) { return in_range(s.offset, s.length, header->blob_size); };
+    for (size_t i = 0; i < header->n_entries; i++) {
+        const IndexEntry& e = entries[i];
+        if (not valid_string(e.file) or not valid_string(e.name) or not valid_string(e.pattern) or
+            not in_range(e.first_variant, e.n_variants, header->n_variants) or not in_range(e.first_link, e.n_links, header->n_links) or
+            not in_range(e.first_segment, e.n_segments, header->n_ids) or not in_range(e.first_gap, e.n_gaps, header->n_ids))
+            reject("is corrupted: motif entry " + to_string(i) + " points out of its tables");
+        for (size_t s = e.first_segment; s < e.first_segment + e.n_segments; s++)
+            if (ids[s] >= header->n_patterns) reject("is corrupted: motif entry " + to_string(i) + " uses an unknown pattern");
+    }
+    for (size_t v = 0; v < header->n_variants; v++)
+        if (not in_range(variants[v].first_component, variants[v].n_components, header->n_components))
+            reject("is corrupted: variant " + to_string(v) + " points out of the component table");
+    for (size_t c = 0; c < header->n_components; c++)
+        if (not valid_string(components[c].pattern) or components[c].id >= header->n_patterns)
+            reject("is corrupted: component " + to_string(c) + " is out of bounds");
+    for (size_t p = 0; p < header->n_patterns; p++)
+        if (not valid_string(patterns[p])) reject("is corrupted: pattern " + to_string(p) + " is out of bounds");
+    if (header->n_states == 0) reject("is corrupted: its scanner has no state");
+    for (size_t q = 0; q < header->n_states; q++) {
+        for (int c = 0; c < 4; c++)
+            if (states[q].transitions[c] < 0 or static_cast<uint64_t>(states[q].transitions[c]) >= header->n_states)
+                reject("is corrupted: scanner state " + to_string(q) + " has an invalid transition");
+        if (not in_range(states[q].first_anchor, states[q].n_anchors, header->n_anchors))
+            reject("is corrupted: scanner state " + to_string(q) + " points out of the anchor table");
+    }
+    for (size_t a = 0; a < header->n_anchors; a++)
+        if (anchors[a].id >= header->n_patterns) reject("is corrupted: anchor " + to_string(a) + " uses an unknown pattern");
+    for (size_t u = 0; u < header->n_unanchored; u++)
+        if (unanchored[u] >= header->n_patterns) reject("is corrupted: unanchored pattern " + to_string(u) + " is unknown");
+
+    auto get_string = [blob](const IndexString& s) { return string(blob + s.offset, s.length); };
+
+    lib.source_ = (header->source == 1) ? "descfolder" : "rinfolder";
+    lib.templates_.reserve(header->n_entries);
+    for (size_t i = 0; i < header->n_entries; i++) {
+        const IndexEntry& e = entries[i];
+        if (e.error) {
+            lib.ignored_.push_back(make_pair(get_string(e.file), e.error));
+            lib.errors_++;
+            continue;
+        }
+        MotifTemplate t;
+        t.file         = path(get_string(e.file));
+        t.name         = get_string(e.name);
+        t.pattern      = get_string(e.pattern);
+        t.carnaval_id  = e.carnaval_id;
+        t.segment_ids  = vector<uint>(ids + e.first_segment, ids + e.first_segment + e.n_segments);
+        t.segment_gaps = vector<uint>(ids + e.first_gap, ids + e.first_gap + e.n_gaps);
+        for (size_t v = e.first_variant; v < e.first_variant + e.n_variants; v++) {
+            t.variants.push_back(vector<string>());
+            t.component_ids.push_back(vector<uint>());
+            t.variants.back().reserve(variants[v].n_components);
+            for (size_t c = variants[v].first_component; c < variants[v].first_component + variants[v].n_components; c++) {
+                t.variants.back().push_back(get_string(components[c].pattern));
+                t.component_ids.back().push_back(components[c].id);
+            }
+        }
+        for (size_t l = e.first_link; l < e.first_link + e.n_links; l++) {
+            Link link;
+            link.nts        = make_pair(links[l].first, links[l].second);
+            link.long_range = links[l].long_range;
+            t.links.push_back(link);
+        }
+        lib.templates_.push_back(t);
+    }
+
+    // The scanner as it was built: only its distinct patterns are compiled again, the automaton is copied as is
+    MotifScanner& scanner = lib.scanner_;
+    for (size_t p = 0; p < header->n_patterns; p++) {
+        scanner.sources_.push_back(get_string(patterns[p]));
+        scanner.patterns_.push_back(GappedPattern(scanner.sources_.back()));
+    }
+    scanner.transitions_.resize(header->n_states);
+    scanner.outputs_.resize(header->n_states);
+    for (size_t q = 0; q < header->n_states; q++) {
+        for (int c = 0; c < 4; c++) scanner.transitions_[q][c] = states[q].transitions[c];
+        for (size_t a = states[q].first_anchor; a < states[q].first_anchor + states[q].n_anchors; a++)
+            scanner.outputs_[q].push_back({anchors[a].id, anchors[a].offset});
+    }
+    scanner.unanchored_ = vector<uint>(unanchored, unanchored + header->n_unanchored);
+    munmap(const_cast<char*>(data), size);
+
+    if (verbose)
+        cout << "\t> " << lib.templates_.size() << " motifs loaded from index " << index_path << " (" << lib.errors_
+             << " ignored motifs)" << endl;
+    return lib;
+}
@@ -0,0 +1,42 @@
+#ifndef MOTIF_LIBRARY_H_
+#define MOTIF_LIBRARY_H_
+
+#include "Motif.h"
+#include "MotifScanner.h"
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+class MotifLibrary
+{
+    public:
+    MotifLibrary(void);
+    MotifLibrary(string source, string source_path, bool verbose);
+    static MotifLibrary  load_index(const string& index_path, bool verbose);
+    void                 save_index(const string& index_path) const;
+    const string&        get_source(void) const;
+    size_t               size(void) const;
+    size_t               get_n_errors(void) const;
+    const MotifTemplate& operator[](size_t i) const;
+    ComponentHits        scan(const string& rna) const;
+
+    private:
+    void index_patterns(void);
+
+    string                     source_;       // "descfolder" or "rinfolder"
+    vector<MotifTemplate>      templates_;    // Valid motifs of the library, read once
+    vector<pair<string, char>> ignored_;      // Invalid motif files, and the error returned by their validation
+    size_t                     errors_;       // Number of ignored (invalid) motif files
+    MotifScanner               scanner_;      // Finds all the component patterns of the library at once
+};
+
+inline const string&        MotifLibrary::get_source(void) const { return source_; }
+inline size_t               MotifLibrary::size(void) const { return templates_.size(); }
+inline size_t               MotifLibrary::get_n_errors(void) const { return errors_; }
+inline const MotifTemplate& MotifLibrary::operator[](size_t i) const { return templates_[i]; }
+inline ComponentHits        MotifLibrary::scan(const string& rna) const { return scanner_.scan(rna); }
+
+#endif    // MOTIF_LIBRARY_H_
@@ -0,0 +1,122 @@
+#include "MotifScanner.h"
+#include <queue>
+
+using namespace std;
+
+
+static inline int nt_index(char c)
+{
+    switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'U': return 3;
+    default: return -1;
+    }
+}
+
+MotifScanner::MotifScanner(void) {}
+
+uint MotifScanner::add_pattern(const string& pattern)
+{
+    map<string, uint>::iterator it = ids_.find(pattern);
+    if (it != ids_.end()) return it->second;
+
+    uint id = patterns_.size();
+    ids_[pattern] = id;
+    patterns_.push_back(GappedPattern(pattern));
+    sources_.push_back(pattern);
+    return id;
+}
+
+void MotifScanner::build(void)
+{
+    transitions_ = vector<array<int, 4>>(1, {-1, -1, -1, -1});
+    outputs_     = vector<vector<Anchor>>(1);
+    unanchored_.clear();
+
+    // Insert the anchor of every pattern in the trie
+    for (uint id = 0; id < patterns_.size(); id++) {
+        const string& p = sources_[id];
+        size_t        best_start = 0, best_length = 0, start = 0;
+        for (size_t i = 0; i <= p.size(); i++) {
+            if (i < p.size() and nt_index(p[i]) >= 0) continue;
+            if (i - start > best_length) {
+                best_start  = start;
+                best_length = i - start;
+            }
+            start = i + 1;
+        }
+        if (!best_length) {
+            unanchored_.push_back(id);
+            continue;
+        }
+        int state = 0;
+        for (size_t i = best_start; i < best_start + best_length; i++) {
+            int c = nt_index(p[i]);
+            if (transitions_[state][c] < 0) {
+                transitions_[state][c] = transitions_.size();
+                transitions_.push_back({-1, -1, -1, -1});
+                outputs_.push_back(vector<Anchor>());
+            }
+            state = transitions_[state][c];
+        }
+        outputs_[state].push_back({id, static_cast<uint>(best_start + best_length - 1)});
+    }
+
+    // Failure links, in breadth-first order, turning the trie into a complete automaton
+    vector<int> failure(transitions_.size(), 0);
+    queue<int>  bfs;
+    for (int c = 0; c < 4; c++) {
+        if (transitions_[0][c] < 0)
+            transitions_[0][c] = 0;
+        else
+            bfs.push(transitions_[0][c]);
+    }
+    while (!bfs.empty()) {
+        int state = bfs.front();
+        bfs.pop();
+        const vector<Anchor>& inherited = outputs_[failure[state]];
+        outputs_[state].insert(outputs_[state].end(), inherited.begin(), inherited.end());
+        for (int c = 0; c < 4; c++) {
+            int next = transitions_[state][c];
+            if (next < 0) {
+                transitions_[state][c] = transitions_[failure[state]][c];
+                continue;
+            }
+            failure[next] = transitions_[failure[state]][c];
+            bfs.push(next);
+        }
+    }
+}
+
+ComponentHits MotifScanner::scan(const string& rna) const
+{
+    ComponentHits hits;
+    hits.starts = vector<vector<uint>>(patterns_.size());
+    hits.lengths.reserve(patterns_.size());
+    hits.slacks.reserve(patterns_.size());
+    hits.rna_length = rna.size();
+    for (const GappedPattern& p : patterns_) {
+        hits.lengths.push_back(p.window());
+        hits.slacks.push_back(p.window() - p.length());
+    }
+
+    int state = 0;
+    for (size_t j = 0; j < rna.size(); j++) {
+        int c = nt_index(rna[j]);
+        if (c < 0) {    // no anchor contains this character
+            state = 0;
+            continue;
+        }
+        state = transitions_[state][c];
+        for (const Anchor& a : outputs_[state])
+            if (j >= a.offset and patterns_[a.id].matches_at(rna, j - a.offset)) hits.starts[a.id].push_back(j - a.offset);
+    }
+
+    for (uint id : unanchored_)
+        for (size_t j = 0; j < rna.size(); j++)
+            if (patterns_[id].matches_at(rna, j)) hits.starts[id].push_back(j);
+
+    return hits;    // the windows of the extended patterns are placed by find_next_ones_in()
+}
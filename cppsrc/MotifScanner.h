@@ -0,0 +1,49 @@
+#ifndef MOTIF_SCANNER_H_
+#define MOTIF_SCANNER_H_
+
+#include "GappedPattern.h"
+#include "Motif.h"
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::array;
+using std::map;
+using std::string;
+using std::vector;
+
+
+class MotifScanner
+{
+    /*
+        Finds every occurrence of every component pattern of a motif library in a single pass over the RNA.
+        Each distinct pattern is anchored on its longest run of literal nucleotides, and an Aho-Corasick automaton
+        over all the anchors is walked along the sequence. Every anchor hit is then checked against the whole pattern.
+    */
+    public:
+    MotifScanner(void);
+    uint          add_pattern(const string& pattern);    // returns the id of the (deduplicated) pattern
+    void          build(void);                           // builds the automaton, once every pattern has been added
+    ComponentHits scan(const string& rna) const;
+    size_t        size(void) const;
+
+    private:
+    friend class MotifLibrary;    // saves the built automaton in its index, and loads it back without building it again
+
+    typedef struct {
+        uint id;        // pattern id
+        uint offset;    // position of the last nucleotide of the anchor in the pattern
+    } Anchor;
+
+    vector<GappedPattern>   patterns_;       // compiled patterns, indexed by id
+    vector<string>          sources_;        // patterns as written, indexed by id
+    map<string, uint>       ids_;            // id of every distinct pattern (only to deduplicate them, not saved in the index)
+    vector<array<int, 4>>   transitions_;    // Aho-Corasick automaton on A, C, G, U
+    vector<vector<Anchor>>  outputs_;        // anchors ending at every state of the automaton (including suffixes)
+    vector<uint>            unanchored_;     // patterns made of wildcards only, tested at every position
+};
+
+inline size_t MotifScanner::size(void) const { return patterns_.size(); }
+
+#endif    // MOTIF_SCANNER_H_
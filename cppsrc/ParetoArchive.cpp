@@ -0,0 +1,48 @@
+#include "ParetoArchive.h"
+
+using namespace std;
+
+
+bool ParetoArchive::by_objective_1::operator()(const SecondaryStructure& a, const SecondaryStructure& b) const
+{
+    // decreasing objective 1, then increasing objective 2, then any order which does not depend on insertion
+    if (a.get_objective_score(1) != b.get_objective_score(1)) return a.get_objective_score(1) > b.get_objective_score(1);
+    if (a.get_objective_score(2) != b.get_objective_score(2)) return a.get_objective_score(2) < b.get_objective_score(2);
+    return a.hash_ < b.hash_;
+}
+
+bool ParetoArchive::by_objective_1::operator()(const SecondaryStructure& a, double obj1) const { return a.get_objective_score(1) > obj1; }
+
+bool ParetoArchive::by_objective_1::operator()(double obj1, const SecondaryStructure& b) const { return obj1 > b.get_objective_score(1); }
+
+
+
+bool ParetoArchive::is_dominated(const SecondaryStructure& s) const
+{
+    // Those which could dominate s are at least as good on objective 1, so they come before x. The last ones are the best
+    // on objective 2: walk back from x while they are not clearly worse than s on objective 2.
+    const_iterator x = archive_.lower_bound(s.get_objective_score(1) - eps_);
+    while (x != archive_.begin()) {
+        --x;
+        if (*x > s) return true;
+        if (x->get_objective_score(2) < s.get_objective_score(2) - 2 * eps_) break;
+    }
+    return false;
+}
+
+bool ParetoArchive::insert(const SecondaryStructure& s)
+{
+    if (is_dominated(s)) return false;
+
+    // Those s dominates are at most as good on objective 1, so they come from x on. The first ones are the worst
+    // on objective 2: walk forward from x while they are not clearly better than s on objective 2.
+    const_iterator x = archive_.upper_bound(s.get_objective_score(1) + eps_);
+    while (x != archive_.end() and x->get_objective_score(2) < s.get_objective_score(2) + 2 * eps_) {
+        if (s > *x)
+            x = archive_.erase(x);
+        else
+            ++x;
+    }
+    archive_.insert(s);
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef PARETO_ARCHIVE_H_
+#define PARETO_ARCHIVE_H_
+
+#include "SecondaryStructure.h"
+#include <set>
+
+using std::multiset;
+
+
+class ParetoArchive
+{
+    /*
+        Set of mutually non-dominated SecondaryStructures (in the sense of operator>), ordered by
+        decreasing objective 1, hence by increasing objective 2. The structures which could dominate a new one are just
+        before its place, and those it dominates just after it: finding them costs O(log P), plus the few structures
+        tied with it.
+    */
+    struct by_objective_1 {
+        typedef void is_transparent;    // allows to look for an objective value
+        bool operator()(const SecondaryStructure& a, const SecondaryStructure& b) const;
+        bool operator()(const SecondaryStructure& a, double obj1) const;
+        bool operator()(double obj1, const SecondaryStructure& b) const;
+    };
+
+    public:
+    typedef multiset<SecondaryStructure, by_objective_1>::const_iterator const_iterator;
+
+    explicit ParetoArchive(double tolerance);    // objective values closer than tolerance are considered equal
+
+    bool           is_dominated(const SecondaryStructure& s) const;
+    bool           insert(const SecondaryStructure& s);    // false if s is dominated, otherwise removes those s dominates
+    void           erase(const_iterator x);
+    size_t         size(void) const;
+    const_iterator begin(void) const;
+    const_iterator end(void) const;
+
+    private:
+    double                                       eps_;
+    multiset<SecondaryStructure, by_objective_1> archive_;
+};
+
+inline ParetoArchive::ParetoArchive(double tolerance) : eps_(tolerance) {}
+inline void                          ParetoArchive::erase(const_iterator x) { archive_.erase(x); }
+inline size_t                        ParetoArchive::size(void) const { return archive_.size(); }
+inline ParetoArchive::const_iterator ParetoArchive::begin(void) const { return archive_.begin(); }
+inline ParetoArchive::const_iterator ParetoArchive::end(void) const { return archive_.end(); }
+
+#endif    // PARETO_ARCHIVE_H_
@@ -1,54 +1,173 @@
 #include "Pool.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sched.h>
+#include <string>
 
-Pool::Pool() : m_function_queue(), m_lock(), m_data_condition(), m_accept_functions(true){}
+unsigned int Pool::n_threads_ = 0;
 
 
 
-Pool::~Pool(){}
+Pool::Pool(unsigned int n_threads) : m_queued(0), m_stop(false)
+{
+    if (n_threads < 1) n_threads = 1;
+    for (unsigned int i = 1; i < n_threads; i++) m_deques.push_back(std::unique_ptr<Deque>(new Deque()));
+    for (size_t i = 0; i < m_deques.size(); i++) m_workers.push_back(std::thread(&Pool::infinite_loop_func, this, i));
+}
 
 
 
-void Pool::push(std::function<void()> func)
+Pool::~Pool()
 {
     std::unique_lock<std::mutex> lock(m_lock);
-    m_function_queue.push(func);
-    // when we send the notification immediately, the consumer will try to get the lock, so unlock asap
+    m_stop = true;
     lock.unlock();
-    m_data_condition.notify_one();
+    m_data_condition.notify_all();
+    for (std::thread& t : m_workers) t.join();
 }
 
 
 
-void Pool::done()
+Pool& Pool::shared(void)
 {
-    std::unique_lock<std::mutex> lock(m_lock);
-    m_accept_functions = false;
+    static Pool pool(n_threads_ ? n_threads_ : available_cpus());
+    return pool;
+}
+
+
+
+unsigned int Pool::available_cpus(void)
+{
+    unsigned int n = std::thread::hardware_concurrency();
+
+    // CPUs we are allowed to run on (taskset, docker --cpuset-cpus...)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (!sched_getaffinity(0, sizeof(set), &set)) n = CPU_COUNT(&set);
+
+    // CPU bandwidth quota of the cgroup (docker --cpus, kubernetes limits...), v2 then v1
+    double        quota = -1, period = -1;
+    std::string   max;
+    std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+    if (cpu_max >> max >> period) {
+        if (max != "max") quota = std::stod(max);
+    } else {
+        std::ifstream cfs_quota("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::ifstream cfs_period("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (!(cfs_quota >> quota and cfs_period >> period)) quota = -1;    // -1 in cfs_quota_us means no quota as well
+    }
+    if (quota > 0 and period > 0) n = std::min(n, static_cast<unsigned int>(std::ceil(quota / period)));
+
+    return n ? n : 1;
+}
+
+
+
+void Pool::run(size_t n, void (*body)(void*, size_t), void* context)
+{
+    if (!n) return;
+    if (m_deques.empty()) {
+        // no worker thread, simply run the loop
+        for (size_t i = 0; i < n; i++) body(context, i);
+        return;
+    }
+
+    // Give a contiguous chunk of the loop to every worker, they will balance the load by stealing
+    Batch batch;
+    batch.remaining = n;
+    for (size_t i = 0; i < n; i++) push(i * m_deques.size() / n, { body, context, i, &batch });
+    std::unique_lock<std::mutex> lock(m_lock);    // sleeping workers check m_queued under this lock: do not notify before
     lock.unlock();
-    // when we send the notification immediately, the consumer will try to get the lock , so unlock asap
     m_data_condition.notify_all();
-    //notify all waiting threads.
+
+    // Help until every task of the loop has been taken, then wait for the last ones to finish
+    Task task;
+    while (batch.remaining.load() and steal(m_deques.size(), task)) execute(task);
+    std::unique_lock<std::mutex> batch_lock(batch.m_lock);
+    batch.m_done.wait(batch_lock, [&batch]() { return !batch.remaining.load(); });
 }
 
 
 
-void Pool::infinite_loop_func()
+void Pool::push(size_t worker, const Task& task)
 {
-    std::function<void()> func;
+    Deque&                       d = *m_deques[worker];
+    std::unique_lock<std::mutex> lock(d.m_lock);
+    if (d.m_count == d.m_ring.size()) {
+        // full: grow the ring, unrolling it from its head
+        std::vector<Task> ring;
+        ring.reserve(std::max<size_t>(16, 2 * d.m_ring.size()));
+        for (size_t k = 0; k < d.m_count; k++) ring.push_back(d.m_ring[(d.m_head + k) % d.m_ring.size()]);
+        ring.resize(ring.capacity());
+        d.m_ring.swap(ring);
+        d.m_head = 0;
+    }
+    d.m_ring[(d.m_head + d.m_count) % d.m_ring.size()] = task;
+    d.m_count++;
+    m_queued++;
+}
+
+
+
+bool Pool::pop(size_t worker, Task& task)
+{
+    Deque&                       d = *m_deques[worker];
+    std::unique_lock<std::mutex> lock(d.m_lock);
+    if (!d.m_count) return false;
+    d.m_count--;
+    task = d.m_ring[(d.m_head + d.m_count) % d.m_ring.size()];
+    m_queued--;
+    return true;
+}
+
+
+
+bool Pool::steal(size_t thief, Task& task)
+{
+    for (size_t k = 1; k <= m_deques.size(); k++) {
+        Deque&                       d = *m_deques[(thief + k) % m_deques.size()];
+        std::unique_lock<std::mutex> lock(d.m_lock);
+        if (!d.m_count) continue;
+        task     = d.m_ring[d.m_head];
+        d.m_head = (d.m_head + 1) % d.m_ring.size();
+        d.m_count--;
+        m_queued--;
+        return true;
+    }
+    return false;
+}
+
+
+
+void Pool::execute(const Task& task)
+{
+    task.run(task.context, task.i);
+
+    // the batch belongs to the thread waiting in run(): it may vanish as soon as remaining reaches 0 and the lock is released
+    std::unique_lock<std::mutex> lock(task.batch->m_lock);
+    if (!--task.batch->remaining) task.batch->m_done.notify_all();
+}
+
+
+
+void Pool::infinite_loop_func(size_t worker)
+{
+    Task task;
     while (true)
     {
+        if (pop(worker, task) or steal(worker, task))
         {
-            std::unique_lock<std::mutex> lock(m_lock);
-            m_data_condition.wait(lock, [this]() {return !m_function_queue.empty() || !m_accept_functions; });
-            if (!m_accept_functions && m_function_queue.empty())
-            {
-                //lock will be release automatically.
-                //finish the thread loop and let it join in the main thread.
-                return;
-            }
-            func = m_function_queue.front();
-            m_function_queue.pop();
-            //release the lock
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_data_condition.wait(lock, [this]() { return m_queued.load() or m_stop; });
+        if (m_stop and !m_queued.load())
+        {
+            //lock will be release automatically.
+            //finish the thread loop and let it join in the main thread.
+            return;
         }
-        func();
     }
-}
\ No newline at end of file
+}
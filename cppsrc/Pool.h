@@ -1,29 +1,70 @@
 #pragma once
 #include <atomic>
-#include <cassert>
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <thread>
+#include <vector>
 
 class Pool
 {
-
-    private:
-    std::queue<std::function<void()>> m_function_queue;
-    std::mutex                        m_lock;
-    std::condition_variable           m_data_condition;
-    std::atomic<bool>                 m_accept_functions;
+    /*
+        Work-stealing thread pool.
+        Every worker owns a deque of tasks: it pops its own tasks from the back, and steals from the front of the
+        other deques when it runs out. A task is a plain function pointer with its context and an index, so queueing
+        one never allocates once the deques have grown. The thread calling parallel_for() works on the loop too,
+        hence a pool of size 1 has no worker thread and runs everything in the caller.
+    */
 
     public:
-    Pool();
+    Pool(unsigned int n_threads);
     ~Pool();
-    std::mutex& get_mutex_reference(void);
-    void push(std::function<void()> func);
-    void done();
-    void infinite_loop_func();
+    unsigned int size(void) const;    // number of threads working on a loop, including the caller
+    template <class F> void parallel_for(size_t n, F& body);    // runs body(i) for every i in [0, n) and waits
+
+    static Pool&        shared(void);            // the process-wide pool, of size n_threads_
+    static unsigned int available_cpus(void);    // CPUs this process may use, considering affinity and cgroup quotas
+    static unsigned int n_threads_;              // size of the shared pool, 0 to use available_cpus()
+
+    private:
+    typedef struct Batch_ {
+        std::atomic<size_t>     remaining;
+        std::mutex              m_lock;
+        std::condition_variable m_done;
+    } Batch;
+
+    typedef struct {
+        void (*run)(void* context, size_t i);
+        void*  context;
+        size_t i;
+        Batch* batch;
+    } Task;
+
+    typedef struct {
+        std::mutex        m_lock;
+        std::vector<Task> m_ring;    // circular buffer holding the deque
+        size_t            m_head = 0, m_count = 0;
+    } Deque;
+
+    void run(size_t n, void (*body)(void*, size_t), void* context);
+    void push(size_t worker, const Task& task);
+    bool pop(size_t worker, Task& task);      // from the back of the worker's own deque
+    bool steal(size_t thief, Task& task);     // from the front of another deque
+    void execute(const Task& task);
+    void infinite_loop_func(size_t worker);
+
+    std::vector<std::unique_ptr<Deque>> m_deques;    // one per worker thread
+    std::vector<std::thread>            m_workers;
+    std::atomic<size_t>                 m_queued;    // tasks waiting in the deques
+    std::mutex                          m_lock;
+    std::condition_variable             m_data_condition;
+    bool                                m_stop;
 };
 
-inline std::mutex &Pool::get_mutex_reference(void) { return m_lock; }
+inline unsigned int Pool::size(void) const { return m_workers.size() + 1; }
 
-class quit_worker_exception : public std::exception {};
\ No newline at end of file
+template <class F> void Pool::parallel_for(size_t n, F& body)
+{
+    run(n, [](void* context, size_t i) { (*static_cast<F*>(context))(i); }, &body);
+}
@@ -0,0 +1,143 @@
+#include "RequestServer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+
+RequestServer::Client_::Client_(int fd) : fd(fd) {}
+
+RequestServer::Client_::~Client_() { close(fd); }
+
+static bool send_all(int fd, const string& message)
+{
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t n = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+RequestServer::RequestServer(int listen_fd, unsigned int n_workers, Handler answer)
+: listen_fd_(listen_fd), n_workers_(n_workers ? n_workers : 1), answer_(answer), requests_(4 * n_workers_), stop_(false)
+{
+    if (pipe(wake_fds_) < 0) throw runtime_error(string("cannot create a pipe: ") + strerror(errno));
+    fcntl(wake_fds_[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_fds_[1], F_SETFL, O_NONBLOCK);
+}
+
+RequestServer::~RequestServer()
+{
+    close(wake_fds_[0]);
+    close(wake_fds_[1]);
+}
+
+void RequestServer::stop(void)
+{
+    stop_ = true;
+    wake();
+}
+
+void RequestServer::wake(void)
+{
+    char    c = 0;
+    ssize_t n = write(wake_fds_[1], &c, 1);    // can only fail if the pipe is full, which wakes run() up as well
+    (void)n;
+}
+
+void RequestServer::work(unsigned int worker)
+{
+    Request r;
+    while (requests_.pop(r)) {
+        string answer = answer_(r.line, worker);
+        if (not send_all(r.client->fd, answer)) r.client->failed = true;
+        lock_guard<mutex> lock(answered_lock_);
+        answered_.push_back(r.client);
+        r.client.reset();
+        wake();
+    }
+}
+
+bool RequestServer::dispatch(const shared_ptr<Client>& client)
+{
+    // Queues the next complete line of the client, if it is not waiting for an answer already
+    if (client->failed) return false;
+    if (client->busy) return true;
+    size_t eol;
+    while ((eol = client->buffer.find('\n')) != string::npos) {
+        string line = client->buffer.substr(0, eol);
+        client->buffer.erase(0, eol + 1);
+        if (line.size() and line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        client->busy = true;
+        requests_.push({ client, line });
+        return true;
+    }
+    return not client->closed;
+}
+
+void RequestServer::run(void)
+{
+    vector<thread> workers;
+    for (unsigned int i = 0; i < n_workers_; i++) workers.push_back(thread(&RequestServer::work, this, i));
+
+    vector<shared_ptr<Client>> clients;    // those waiting for an answer are not polled until they get it
+    vector<pollfd>             fds;
+    vector<shared_ptr<Client>> polled;
+    while (not stop_) {
+        fds.assign({ { wake_fds_[0], POLLIN, 0 }, { listen_fd_, POLLIN, 0 } });
+        polled.clear();
+        for (const shared_ptr<Client>& c : clients)
+            if (not c->busy) {
+                fds.push_back({ c->fd, POLLIN, 0 });
+                polled.push_back(c);
+            }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].revents) {
+            char drain[256];
+            while (read(wake_fds_[0], drain, sizeof(drain)) > 0) continue;
+            vector<shared_ptr<Client>> answered;
+            {
+                lock_guard<mutex> lock(answered_lock_);
+                answered.swap(answered_);
+            }
+            for (const shared_ptr<Client>& c : answered) {
+                c->busy = false;
+                if (not dispatch(c)) clients.erase(find(clients.begin(), clients.end(), c));
+            }
+        }
+
+        for (size_t i = 0; i < polled.size(); i++) {
+            if (not fds[i + 2].revents) continue;
+            shared_ptr<Client>& c = polled[i];
+            char                chunk[4096];
+            ssize_t             n = recv(c->fd, chunk, sizeof(chunk), 0);
+            if (n > 0)
+                c->buffer.append(chunk, n);
+            else if (n == 0 or (errno != EINTR and errno != EAGAIN))
+                c->closed = true;    // the requests it sent before closing are still answered
+            if (not dispatch(c)) clients.erase(find(clients.begin(), clients.end(), c));
+        }
+
+        if (fds[1].revents) {
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd >= 0) clients.push_back(make_shared<Client>(fd));
+        }
+    }
+
+    requests_.close();
+    for (thread& t : workers) t.join();
+}
@@ -0,0 +1,63 @@
+#ifndef REQUEST_SERVER_H_
+#define REQUEST_SERVER_H_
+
+#include "BoundedQueue.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+class RequestServer
+{
+    /*
+        Answers the line-based requests of the clients of a listening socket with a pool of workers.
+        A single thread accepts the clients and reads their requests, and pushes them on a bounded queue drained by
+        the workers: a worker is only busy while it computes an answer, so idle clients cost no worker. A client has at
+        most one request in the queue at a time, hence its answers come back in the order of its requests, and one
+        client sending many requests cannot starve the others.
+    */
+    public:
+    typedef std::function<string(const string& request, unsigned int worker)> Handler;
+
+    RequestServer(int listen_fd, unsigned int n_workers, Handler answer);
+    ~RequestServer();
+    void run(void);     // serves until stop() is called
+    void stop(void);    // can be called from any thread
+
+    private:
+    typedef struct Client_ {
+        int    fd;
+        string buffer;              // received, not yet dispatched
+        bool   busy = false;        // one of its requests is in the queue or being answered
+        bool   closed = false;      // it will not send anything more
+        bool   failed = false;      // an answer could not be sent
+        explicit Client_(int fd);
+        ~Client_();
+    } Client;
+
+    typedef struct {
+        std::shared_ptr<Client> client;
+        string                  line;
+    } Request;
+
+    void work(unsigned int worker);
+    bool dispatch(const std::shared_ptr<Client>& client);    // false if the client can be dropped
+    void wake(void);
+
+    int                                  listen_fd_;
+    unsigned int                         n_workers_;
+    Handler                              answer_;
+    int                                  wake_fds_[2];    // workers and stop() write to it to wake up run()
+    BoundedQueue<Request>                requests_;
+    std::mutex                           answered_lock_;
+    vector<std::shared_ptr<Client>>      answered_;       // clients whose answer was sent, back to run()
+    std::atomic<bool>                    stop_;
+};
+
+#endif    // REQUEST_SERVER_H_
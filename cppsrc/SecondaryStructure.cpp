@@ -2,22 +2,24 @@
 #include "MOIP.h"
 #include <algorithm>
 #include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
+#include <cstring>
 
 using std::abs;
 using std::cout;
 using std::endl;
 
 
-SecondaryStructure::SecondaryStructure() {}
+SecondaryStructure::SecondaryStructure() : hash_(0), insertion_sites_(nullptr) {}
 
 
-SecondaryStructure::SecondaryStructure(const RNA& rna)
-: objective_scores_(vector<double>(2)), n_(rna.get_RNA_length()), nBP_(0), rna_(rna)
+SecondaryStructure::SecondaryStructure(shared_ptr<const RNA> rna, const vector<Motif>& insertion_sites)
+: objective_scores_(vector<double>(2)), n_(rna->get_RNA_length()), nBP_(0), hash_(0), rna_(rna), insertion_sites_(&insertion_sites)
 {
     is_empty_structure = false;
 }
 
-SecondaryStructure::SecondaryStructure(bool empty) : rna_(RNA()) { is_empty_structure = empty; }
+SecondaryStructure::SecondaryStructure(bool empty) : hash_(0), insertion_sites_(nullptr) { is_empty_structure = empty; }
 
 
 
@@ -102,7 +104,7 @@ string SecondaryStructure::to_string(void) const
 {
     string s;
     s += to_DBN();
-    for (const Motif& m : motif_info_) s += " + " + m.get_identifier();
+    for (uint i = 0; i < get_n_motifs(); i++) s += " + " + get_motif(i).get_identifier();
     s += "\t" + boost::str(boost::format("%.7f") % objective_scores_[0]) + "\t" +
          boost::str(boost::format("%.7f") % objective_scores_[1]);
     return s;
@@ -117,17 +119,18 @@ void SecondaryStructure::set_basepair(uint i, uint j)
     basepairs_.push_back(bp);
 }
 
-void SecondaryStructure::insert_motif(const Motif& m) { motif_info_.push_back(m); }
+void SecondaryStructure::insert_motif(uint site) { motifs_.push_back(site); }
 
 
 
 void SecondaryStructure::print(void) const
 {
     cout << endl;
-    cout << '\t' << rna_.get_seq() << endl;
+    cout << '\t' << rna_->get_seq() << endl;
     cout << '\t' << to_string() << endl;
-    for (const Motif& m : motif_info_) {
-        uint i = 0;
+    for (uint k = 0; k < get_n_motifs(); k++) {
+        const Motif& m = get_motif(k);
+        uint         i = 0;
         cout << '\t';
         for (auto c : m.comp) {
             while (i != c.pos.second + 1) {
@@ -150,7 +153,14 @@ void SecondaryStructure::print(void) const
 void SecondaryStructure::sort(void)
 {
     std::sort(basepairs_.begin(), basepairs_.end(), basepair_sorter);
-    std::sort(motif_info_.begin(), motif_info_.end(), motif_sorter);
+    // motifs are printed by identifier, ties are kept in insertion site order
+    std::sort(motifs_.begin(), motifs_.end());
+    std::stable_sort(motifs_.begin(), motifs_.end(), [this](uint a, uint b) {
+        return (*insertion_sites_)[a].get_identifier() < (*insertion_sites_)[b].get_identifier();
+    });
+
+    hash_ = boost::hash_range(basepairs_.begin(), basepairs_.end());
+    boost::hash_range(hash_, motifs_.begin(), motifs_.end());
 }
 
 bool basepair_sorter(pair<uint, uint>& i, pair<uint, uint>& j)
@@ -160,12 +170,6 @@ bool basepair_sorter(pair<uint, uint>& i, pair<uint, uint>& j)
     return false;
 }
 
-bool motif_sorter(Motif& m1, Motif& m2)
-{
-    if (m1.get_identifier().compare(m2.get_identifier()) < 0) return true;
-    return false;
-}
-
 bool operator>(const SecondaryStructure& s1, const SecondaryStructure& s2)
 {
     double s11 = s1.get_objective_score(1);
@@ -286,16 +290,15 @@ bool operator==(const SecondaryStructure& s1, const SecondaryStructure& s2)
     // Checks wether the secondary structures are exactly the same, including the inserted motifs.
 
     // fast checks to refute the equality
+    if (s1.hash_ != s2.hash_) return false;
     if (s1.get_objective_score(1) != s2.get_objective_score(1)) return false;
     if (s1.get_objective_score(2) != s2.get_objective_score(2)) return false;
     if (s1.get_n_motifs() != s2.get_n_motifs()) return false;
     if (s1.get_n_bp() != s2.get_n_bp()) return false;
 
-    // Deep checking
-    for (uint i = 0; i < s1.get_n_bp(); i++)
-        if (s1.basepairs_[i] != s2.basepairs_[i]) return false;
-    for (uint i = 0; i < s1.get_n_motifs(); i++)
-        if (s1.motif_info_[i] != s2.motif_info_[i]) return false;
+    // Deep checking (both structures come from the same MOIP, motifs are compared by insertion site)
+    if (s1.get_n_bp() and memcmp(s1.basepairs_.data(), s2.basepairs_.data(), s1.get_n_bp() * sizeof(pair<uint, uint>))) return false;
+    if (s1.get_n_motifs() and memcmp(s1.motifs_.data(), s2.motifs_.data(), s1.get_n_motifs() * sizeof(uint))) return false;
     return true;
 }
 
@@ -4,10 +4,12 @@
 #include "Motif.h"
 #include "rna.h"
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 using std::pair;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -16,27 +18,30 @@ class SecondaryStructure
 {
     public:
     SecondaryStructure(void);
-    SecondaryStructure(const RNA& rna);
+    SecondaryStructure(shared_ptr<const RNA> rna, const vector<Motif>& insertion_sites);
     SecondaryStructure(bool empty);
 
-    void   set_basepair(uint i, uint j);
-    void   sort(void);
-    void   insert_motif(const Motif& m);
-    double get_objective_score(int i) const;
-    void   set_objective_score(int i, double s);
-    uint   get_n_motifs(void) const;
-    uint   get_n_bp(void) const;
-    void   print(void) const;
-    string to_DBN() const;
-    string to_string() const;
+    void         set_basepair(uint i, uint j);
+    void         sort(void);                 // call once the basepairs and motifs are set: sorts them and computes the hash
+    void         insert_motif(uint site);    // index of the motif in the insertion sites
+    double       get_objective_score(int i) const;
+    void         set_objective_score(int i, double s);
+    uint         get_n_motifs(void) const;
+    const Motif& get_motif(uint i) const;
+    uint         get_n_bp(void) const;
+    void         print(void) const;
+    string       to_DBN() const;
+    string       to_string() const;
 
 
     vector<double> objective_scores_;       // values of the different objective functions for that SecondaryStructure
     vector<pair<uint, uint>> basepairs_;    // values of the decision variable of the integer program
-    vector<Motif> motif_info_;    // information about known motives in this secondary structure and their positions
+    vector<uint>  motifs_;        // known motives in this secondary structure, as indexes in insertion_sites_
     size_t        n_;             // length of the RNA
     size_t        nBP_;           // number of basepairs
-    RNA           rna_;           // RNA object which is folded
+    size_t        hash_;          // hash of the basepairs and motifs, computed by sort()
+    shared_ptr<const RNA> rna_;                // RNA object which is folded, shared by all its structures
+    const vector<Motif>*  insertion_sites_;    // insertion sites of the MOIP which found this structure (it must outlive it)
     bool          is_empty_structure;    // Empty structure, returned when the solver does not find solutions anymore
 };
 
@@ -50,12 +55,12 @@ bool operator<=(const SecondaryStructure& s1, const SecondaryStructure& s2);
 bool operator==(const SecondaryStructure& s1, const SecondaryStructure& s2);
 bool operator!=(const SecondaryStructure& s1, const SecondaryStructure& s2);
 
-bool motif_sorter(Motif& m1, Motif& m2);
 bool basepair_sorter(pair<uint, uint>& i, pair<uint, uint>& j);
 
 inline double SecondaryStructure::get_objective_score(int i) const { return objective_scores_[i - 1]; }
 inline void   SecondaryStructure::set_objective_score(int i, double s) { objective_scores_[i - 1] = s; }
-inline uint   SecondaryStructure::get_n_motifs(void) const { return motif_info_.size(); }
+inline uint   SecondaryStructure::get_n_motifs(void) const { return motifs_.size(); }
+inline const Motif& SecondaryStructure::get_motif(uint i) const { return (*insertion_sites_)[motifs_[i]]; }
 inline uint   SecondaryStructure::get_n_bp(void) const { return nBP_; }
 
 
@@ -5,15 +5,31 @@
 ***/
 
 #include <algorithm>
+#include <atomic>
 #include <boost/program_options.hpp>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
 #include <vector>
 
 #include "MOIP.h"
 #include "Motif.h"
+#include "MotifLibrary.h"
+#include "Pool.h"
+#include "RequestServer.h"
 #include "fa.h"
 
 using namespace std;
@@ -52,18 +68,197 @@ string remove_ext(const char* mystr, char dot, char sep)
 	return string(retstr);
 }
 
+ostream* solution_stream = nullptr;    // --stream: where to write the solutions as soon as they are found
+mutex    solution_stream_access;
+bool     status_comments = false;    // --status-comments: say on a line of its own when a record's search was cut short
+
+void fold(const Fasta& fa, const MotifLibrary& library, const string& source, const string& motifs_path_name, float theta_p_threshold,
+char obj_function_nbr, bool verbose, unsigned int job, ostream& out)
+{
+	// Runs the whole RNA -> MOIP -> Pareto search pipeline on one sequence, and writes the Pareto set to out.
+	// Motifs are taken from the (already loaded) library, or from the CSV file motifs_path_name for CSV sources.
+	// job is the index of the worker running it, among the MOIP::n_jobs_ concurrent ones.
+	// Throws if anything fails, before anything is written.
+
+	SecondaryStructure    bestSSO1(true), bestSSO2(true);    // stay empty if a budget runs out before they are found
+	static mutex          vienna_access;    // ViennaRNA's global energy parameters are not meant to be shared between threads
+
+	if (verbose) cout << "loading " << fa.name() << "..." << endl;
+	unique_lock<mutex>    lock(vienna_access);
+	shared_ptr<const RNA> myRNA = make_shared<const RNA>(fa.name(), fa.seq(), verbose);    // shared by the MOIP and its solutions
+	lock.unlock();
+	if (verbose) cout << "\t> " << fa.name() << " successfuly loaded (" << myRNA->get_RNA_length() << " nt)" << endl;
+
+	/*  FIND PARETO SET  */
+	MOIP myMOIP = (source == "jar3dcsv" or source == "bayespaircsv")
+				  ? MOIP(myRNA, source, motifs_path_name.c_str(), theta_p_threshold, verbose)
+				  : MOIP(myRNA, library, theta_p_threshold, verbose, obj_function_nbr);
+	myMOIP.set_job(job);
+	if (solution_stream) {
+		myMOIP.set_solution_callback([&fa](const SecondaryStructure& s) {
+			lock_guard<mutex> stream_lock(solution_stream_access);
+			*solution_stream << fa.name() << '\t' << s.to_string() << endl;    // flushed, to be read while the search runs
+		});
+	}
+
+	if (verbose)
+		cout << "Solving..." << endl;
+	if (MOIP::n_solvers_ > 1)
+		myMOIP.search_in_parallel(bestSSO1, bestSSO2);
+	else
+		myMOIP.search_front(bestSSO1, bestSSO2);
+
+	/*  DISPLAY RESULTS  */
+
+	// print the pareto set
+	if (verbose) {
+		cout << endl << endl << "---------------------------------------------------------------" << endl;
+		cout << "Whole Pareto Set:" << endl;
+		for (const SecondaryStructure& s : myMOIP.get_pareto()) s.print();
+		cout << endl;
+		cout << myMOIP.get_n_candidates() << " candidate insertion sites, " << myMOIP.get_n_solutions() << " solutions kept." << endl;
+		if (!bestSSO1.is_empty_structure) cout << "Best value for Motif insertion objective: " << bestSSO1.get_objective_score(1) << endl;
+		if (!bestSSO2.is_empty_structure) cout << "Best value for structure expected accuracy: " << bestSSO2.get_objective_score(2) << endl;
+	}
+
+	// A search cut by a budget still succeeds, with the front found so far. The record keeps its usual layout,
+	// --status-comments adds a comment line before it to say it is partial.
+	if (myMOIP.get_status() != MOIP::COMPLETE) {
+		cerr << "\033[33m" << fa.name() << ": search stopped (" << myMOIP.status_string() << "), writing the " << myMOIP.get_n_solutions()
+			 << " solutions found so far.\033[0m" << endl;
+		if (status_comments) out << "# " << myMOIP.status_string() << endl;
+	}
+	out << fa.name() << endl << fa.seq() << endl;
+	for (const SecondaryStructure& s : myMOIP.get_pareto()) out << s.to_string() << endl;
+}
+
+bool fold_sequence(
+const Fasta& fa, const MotifLibrary& library, const string& source, const string& motifs_path_name, float theta_p_threshold,
+char obj_function_nbr, bool verbose, unsigned int job, ostream& out)
+{
+	// fold(), but a failure only concerns this sequence: it is reported on its header line, without structures,
+	// and the other records of a --batch or the requests of a --serve go on. Returns false if it failed.
+	string error;
+	try {
+		ostringstream result;    // nothing is written if the fold fails halfway
+		fold(fa, library, source, motifs_path_name, theta_p_threshold, obj_function_nbr, verbose, job, result);
+		out << result.str();
+		return true;
+	} catch (IloException& e) {
+		error = string("Cplex Exception: ") + e.getMessage();
+	} catch (exception& e) {
+		error = e.what();
+	}
+	cerr << "\033[31m" << fa.name() << ": " << error << "\033[0m" << endl;
+	out << fa.name() << "\tfailed: " << error << endl << fa.seq() << endl;
+	return false;
+}
+
+vector<string> output_file_names(const string& folder, const vector<Fasta>& records)
+{
+	// One file name per record of the FASTA file in --batch mode, built from the FASTA header.
+	// Headers identical up to their first space get the record's index appended, so no file overwrites another.
+	vector<string>        names;
+	unordered_set<string> taken;
+	for (size_t i = 0; i < records.size(); i++) {
+		string name = records[i].name().substr(0, records[i].name().find_first_of(" \t"));
+		for (char& c : name)
+			if (not isalnum(c) and c != '-' and c != '_' and c != '.') c = '_';
+		if (name.empty()) name = "unnamed";
+		string unique_name = name;
+		for (size_t k = i + 1; not taken.insert(unique_name).second; k += records.size()) unique_name = name + "_" + to_string(k);
+		names.push_back((path(folder) / (unique_name + ".txt")).string());
+	}
+	return names;
+}
+
+string answer_request(const string& request, const MotifLibrary& library, float theta_p_threshold, char obj_function_nbr, bool verbose, unsigned int job)
+{
+	// A request is one line: [>name] sequence [theta] [function]
+	// The answer is formatted like the --output file, and ends with an empty line.
+
+	istringstream  fields(request);
+	vector<string> tokens((istream_iterator<string>(fields)), istream_iterator<string>());
+	string         name = "query";
+	float          theta = theta_p_threshold;
+	char           function = obj_function_nbr;
+
+	if (tokens.size() and tokens[0][0] == '>') {
+		name = tokens[0].substr(1);
+		tokens.erase(tokens.begin());
+	}
+	if (tokens.empty() or tokens.size() > 3) return "ERROR expected: [>name] sequence [theta] [function]\n\n";
+	if (find_if(tokens[0].begin(), tokens[0].end(), [](char c) { return not isalpha(c); }) != tokens[0].end())
+		return "ERROR the sequence must only contain letters\n\n";
+	if (tokens.size() > 1) {
+		try {
+			theta = stof(tokens[1]);
+		} catch (logic_error& e) {
+			return "ERROR invalid theta " + tokens[1] + "\n\n";
+		}
+	}
+	if (tokens.size() > 2) {
+		if (tokens[2].size() != 1 or (tokens[2][0] != 'A' and tokens[2][0] != 'B'))
+			return "ERROR invalid function " + tokens[2] + ", only A and B can be used with motif folders\n\n";
+		function = tokens[2][0];
+	}
+
+	ostringstream out;
+	if (not fold_sequence(Fasta(name, tokens[0]), library, library.get_source(), "", theta, function, verbose, job, out))
+		return "ERROR the solver failed on " + name + "\n\n";
+	return out.str() + "\n";
+}
+
+int serve(const string& socket_path, unsigned int n_workers, const MotifLibrary& library, float theta_p_threshold, char obj_function_nbr, bool verbose)
+{
+	// Daemon mode: the motif library stays in memory, and fold requests are read from a local UNIX socket.
+
+	sockaddr_un address;
+	if (socket_path.size() >= sizeof(address.sun_path)) {
+		cerr << "\033[31mSocket path " << socket_path << " is too long\033[0m" << endl;
+		return EXIT_FAILURE;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socket_path.c_str());
+
+	int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socket_path.c_str());
+	if (server_fd < 0 or bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 or listen(server_fd, SOMAXCONN) < 0) {
+		cerr << "\033[31mCannot listen on " << socket_path << ": " << strerror(errno) << "\033[0m" << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "Listening on " << socket_path << " with " << n_workers << " workers (" << library.size() << " motifs loaded)." << endl;
+
+	// The number of workers bounds the number of concurrent folds, not the number of clients
+	RequestServer server(server_fd, n_workers, [&](const string& request, unsigned int worker) {
+		return answer_request(request, library, theta_p_threshold, obj_function_nbr, verbose, worker);
+	});
+	server.run();
+
+	close(server_fd);
+	unlink(socket_path.c_str());
+	return EXIT_SUCCESS;
+}
+
+bool quiet_jobs(bool verbose)
+{
+	// Concurrent jobs would interleave their verbose output on stdout
+	if (verbose) cerr << "\033[33m--verbose is ignored with several --jobs.\033[0m" << endl;
+	return false;
+}
+
 int main(int argc, char* argv[])
 {
 	/*  VARIABLE DECLARATIONS  */
 
-	string             inputName, outputName, motifs_path_name, basename;
+	string             inputName, outputName, outputDir, socketName, indexName, streamName, motifs_path_name, basename;
 	bool               verbose = false;
 	float              theta_p_threshold;
 	char               obj_function_nbr = 'B';
+	unsigned int       n_jobs;
 	list<Fasta>        f;
-	ofstream           outfile;
-	SecondaryStructure bestSSO1, bestSSO2;
-	RNA                myRNA;
+	ofstream           outfile, streamfile;
 
 	/*  ARGUMENT CHECKING  */
 
@@ -71,9 +266,11 @@ int main(int argc, char* argv[])
 	desc.add_options()
 	("help,h", "Print the help message")
 	("version", "Print the program version")
-	("seq,s", po::value<string>(&inputName)->required(), "Fasta file containing the RNA sequence")
+	("seq,s", po::value<string>(&inputName), "Fasta file containing the RNA sequence")
 	("descfolder,d", po::value<string>(&motifs_path_name), "A folder containing modules in .desc format, as produced by Djelloul & Denise's catalog program")
 	("rinfolder,x", po::value<string>(&motifs_path_name), "A folder containing CaRNAval's RINs in .txt format, as produced by script transform_caRNAval_pickle.py")
+	("library", po::value<string>(&motifs_path_name), "A binary index of a DESC or RIN folder, as produced by --compile-library, to load the motifs without parsing them again")
+	("compile-library", po::value<string>(&indexName), "Validate and parse the --descfolder or --rinfolder motifs once, save them to this binary index file, and exit")
 	("jar3dcsv,j", po::value<string>(&motifs_path_name), "A file containing the output of JAR3D's search for motifs in the sequence, as produced by biorseo.py")
 	("bayespaircsv,b", po::value<string>(&motifs_path_name), "A file containing the output of BayesPairing's search for motifs in the sequence, as produced by biorseo.py")
 	("first-objective,c", po::value<unsigned int>(&MOIP::obj_to_solve_)->default_value(1), "Objective to solve in the mono-objective portions of the algorithm")
@@ -82,7 +279,34 @@ int main(int argc, char* argv[])
 	("function,f", po::value<char>(&obj_function_nbr)->default_value('B'), "What objective function to use to include motifs: square of motif size in nucleotides like "
 	"RNA-MoIP (A), light motif size + high number of components (B), site score (C), light motif size + site score + high number of components (D)")
 	("disable-pseudoknots,n", "Add constraints forbidding the formation of pseudoknots")
-	("limit,l", po::value<unsigned int>(&MOIP::max_sol_nbr_)->default_value(500), "Intermediate number of solutions in the Pareto set above which we give up the calculation.")
+	("pk-formulation", po::value<char>(&MOIP::pk_formulation_)->default_value('A'), "How --disable-pseudoknots forbids them: one constraint per pair of crossing "
+	"basepairs (A), or one per basepair and nucleotide inside it, covering all the crossings there (B)")
+	("export-model", po::value<string>(&MOIP::export_model_), "Export every model to this file (.lp, .mps or .sav) before it is solved, with named variables, to inspect them. "
+	"With several --jobs or --solvers, each writes its own file, e.g. model.job1.solver2.lp")
+	("solvers", po::value<unsigned int>(&MOIP::n_solvers_)->default_value(1), "Number of CPLEX solvers exploring independent parts of the Pareto front "
+	"concurrently, each with its own copy of the model and a share of the CPUs (default 1: a single solver, depth-first)")
+	("limit,l", po::value<unsigned int>(&MOIP::max_sol_nbr_)->default_value(500), "Intermediate number of solutions in the Pareto set above which we stop the calculation, "
+	"and output the partial Pareto set")
+	("time-limit", po::value<double>(&MOIP::time_limit_)->default_value(0), "Wall-clock budget of one sequence, in seconds: when it runs out, the search stops "
+	"and outputs the partial Pareto set (default 0: none)")
+	("solve-time-limit", po::value<double>(&MOIP::solve_time_limit_)->default_value(0), "Budget of each CPLEX solve, in seconds: a solve cut short keeps no "
+	"solution, its part of the Pareto front is left to --resume (default 0: none)")
+	("stream", po::value<string>(&streamName), "A file where to write every structure as soon as it enters the Pareto set, as 'name<tab>structure' lines. "
+	"Some may be dominated later, and a resumed search writes again those found after its last checkpoint: the --output file "
+	"holds the final sets")
+	("checkpoint-dir", po::value<string>(&MOIP::checkpoint_dir_), "A folder where to save the state of the Pareto searches regularly, and when a budget "
+	"stops them: one file per sequence, library and parameters, removed once the search is complete")
+	("checkpoint-interval", po::value<double>(&MOIP::checkpoint_interval_)->default_value(600), "Seconds between two checkpoints of a search")
+	("status-comments", "Write a '# incomplete: <reasons>' line before the records whose search was stopped by a budget "
+	"(by default, the output keeps its usual layout and this is only reported on stderr)")
+	("resume", "Continue the searches from their checkpoints in --checkpoint-dir, if there are some (the others start from scratch)")
+	("batch", "Fold every sequence of the FASTA file, not only the first one")
+	("jobs", po::value<unsigned int>(&n_jobs)->default_value(1), "Number of sequences folded concurrently in --batch or --serve mode (in --batch mode, longest sequences are started first)")
+	("threads", po::value<unsigned int>(&Pool::n_threads_)->default_value(0), "Number of threads searching for motif insertion sites, shared by all the --jobs "
+	"(default 0: as many as the CPUs available to the process, considering its affinity and cgroup CPU quota)")
+	("outputdir", po::value<string>(&outputDir), "In --batch mode, a folder where to write one result file per sequence, instead of a single --output file")
+	("serve", po::value<string>(&socketName), "Run as a daemon: load the --descfolder, --rinfolder or --library motifs once, then answer fold requests "
+	"sent to this UNIX socket. A request is a line '[>name] sequence [theta] [function]', the answer is formatted like the --output file and ends with an empty line.")
 	("verbose,v", "Print what is happening to stdout");
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -107,8 +331,8 @@ int main(int argc, char* argv[])
 		if (vm.count("verbose")) verbose = true;
 		if (vm.count("disable-pseudoknots")) MOIP::allow_pk_ = false;
 
-		if (!vm.count("jar3dcsv") and !vm.count("bayespaircsv") and !vm.count("descfolder") and !vm.count("rinfolder")) {
-			cerr << "\033[31mYou must provide at least one of --descfolder, --rinfolder, --jar3dcsv or --bayespaircsv.\033[0m See --help "
+		if (!vm.count("jar3dcsv") and !vm.count("bayespaircsv") and !vm.count("descfolder") and !vm.count("rinfolder") and !vm.count("library")) {
+			cerr << "\033[31mYou must provide at least one of --descfolder, --rinfolder, --library, --jar3dcsv or --bayespaircsv.\033[0m See --help "
 					"for more information."
 				 << endl;
 			return EXIT_FAILURE;
@@ -121,7 +345,40 @@ int main(int argc, char* argv[])
 			return EXIT_FAILURE;
 		}
 
+		if (!vm.count("seq") and !vm.count("serve") and !vm.count("compile-library")) {
+			cerr << "\033[31mYou must provide a sequence with --seq, or run a server with --serve.\033[0m See --help for more information."
+				 << endl;
+			return EXIT_FAILURE;
+		}
+
+		if (vm.count("compile-library") and !vm.count("descfolder") and !vm.count("rinfolder")) {
+			cerr << "\033[31m--compile-library requires --descfolder or --rinfolder.\033[0m See --help for more information." << endl;
+			return EXIT_FAILURE;
+		}
+
+		if (vm.count("serve") and !vm.count("descfolder") and !vm.count("rinfolder") and !vm.count("library")) {
+			cerr << "\033[31m--serve requires --descfolder, --rinfolder or --library.\033[0m See --help for more information." << endl;
+			return EXIT_FAILURE;
+		}
+
+		if (vm.count("batch") and (vm.count("jar3dcsv") or vm.count("bayespaircsv"))) {
+			cerr << "\033[31m--batch requires --descfolder, --rinfolder or --library, JAR3D and BayesPairing CSV files are specific to one sequence.\033[0m See "
+					"--help for more information."
+				 << endl;
+			return EXIT_FAILURE;
+		}
+
 		po::notify(vm);    // throws on error, so do after help in case there are any problems
+		if (MOIP::pk_formulation_ != 'A' and MOIP::pk_formulation_ != 'B') {
+			cerr << "\033[31m--pk-formulation must be A or B.\033[0m See --help for more information." << endl;
+			return EXIT_FAILURE;
+		}
+		if (vm.count("resume") and !vm.count("checkpoint-dir")) {
+			cerr << "\033[31m--resume requires --checkpoint-dir.\033[0m See --help for more information." << endl;
+			return EXIT_FAILURE;
+		}
+		if (vm.count("resume")) MOIP::resume_ = true;
+		if (vm.count("status-comments")) status_comments = true;
 	} catch (po::error& e) {
 		cerr << "ERROR: \033[31m" << e.what() << "\033[0m" << endl;
 		cerr << desc << endl;
@@ -132,26 +389,6 @@ int main(int argc, char* argv[])
 
 	/*  FILE PARSING  */
 
-	// load fasta file
-	if (verbose) cout << "Reading input files..." << endl;
-	if (access(inputName.c_str(), F_OK) == -1) {
-		cerr << "\033[31m" << inputName << " not found\033[0m" << endl;
-		return EXIT_FAILURE;
-	}
-	Fasta::load(f, inputName.c_str());
-	list<Fasta>::iterator fa = f.begin();
-	if (verbose) cout << "loading " << fa->name() << "..." << endl;
-	myRNA = RNA(fa->name(), fa->seq(), verbose);
-	if (verbose) cout << "\t> " << inputName << " successfuly loaded (" << myRNA.get_RNA_length() << " nt)" << endl;
-
-	// load CSV file
-	if (access(motifs_path_name.c_str(), F_OK) == -1) {
-		cerr << "\033[31m" << motifs_path_name << " not found\033[0m" << endl;
-		return EXIT_FAILURE;
-	}
-
-
-	/*  FIND PARETO SET  */
 	string source;
 	if (vm.count("jar3dcsv"))
 		source = "jar3dcsv";
@@ -159,88 +396,115 @@ int main(int argc, char* argv[])
 		source = "bayespaircsv";
 	else if (vm.count("rinfolder"))
 		source = "rinfolder";
-	else
+	else if (vm.count("descfolder"))
 		source = "descfolder";
+	else
+		source = "library";
 
-	MOIP               myMOIP = MOIP(myRNA, source, motifs_path_name.c_str(), theta_p_threshold, verbose);
-	double             min, max;
-	IloConstraintArray F(myMOIP.get_env());
-
-	if (verbose)
-		cout << "Solving..." << endl;
-	try {
-		bestSSO1 = myMOIP.solve_objective(1, -__DBL_MAX__, __DBL_MAX__);
-		if (verbose) cout << endl;
-		bestSSO2 = myMOIP.solve_objective(2, -__DBL_MAX__, __DBL_MAX__);
-		if (verbose) {
-			cout << endl << "Best solution according to objective 1 :" << bestSSO1.to_string() << endl;
-			cout << "Best solution according to objective 2 :" << bestSSO2.to_string() << endl;
-		}
-
-		// extend the Pareto set on top
-		if (MOIP::obj_to_solve_ == 1) {
-			myMOIP.add_solution(bestSSO1);
-			min = bestSSO1.get_objective_score(2) + MOIP::precision_;
-			max = bestSSO2.get_objective_score(2);
-			if (verbose) cout << endl << "Solving obj1 on top of best solution 1." << endl;
-		} else {
-			myMOIP.add_solution(bestSSO2);
-			min = bestSSO2.get_objective_score(1) + MOIP::precision_;
-			max = bestSSO1.get_objective_score(1);
-			if (verbose) cout << endl << "Solving obj2 on top of best solution 2." << endl;
-		}
-
-		if (verbose)
-			cout << setprecision(-log10(MOIP::precision_) + 4) << "\nSolving objective function " << MOIP::obj_to_solve_ << ", on top of "
-				 << min << ": Obj" << 3 - MOIP::obj_to_solve_ << "  being in [" << min << ", " << max << "]..." << endl;
-		myMOIP.search_between(min, max);
+	// load CSV file, or the motif library once for all the sequences
+	if (access(motifs_path_name.c_str(), F_OK) == -1) {
+		cerr << "\033[31m" << motifs_path_name << " not found\033[0m" << endl;
+		return EXIT_FAILURE;
+	}
+	MotifLibrary library;
+	if (source == "descfolder" or source == "rinfolder") {
+		if (verbose) cout << "Loading motif library..." << endl;
+		library = MotifLibrary(source, motifs_path_name, verbose);
+	} else if (source == "library") {
+		if (verbose) cout << "Loading motif library index..." << endl;
+		library = MotifLibrary::load_index(motifs_path_name, verbose);
+		source  = library.get_source();
+	}
 
+	if (vm.count("compile-library")) {
+		library.save_index(indexName);
+		cout << library.size() << " motifs (and " << library.get_n_errors() << " invalid files) saved to " << indexName << endl;
+		return EXIT_SUCCESS;
+	}
 
-		// extend the Pareto set below
-		if (MOIP::obj_to_solve_ == 1) {
-			if (verbose) cout << endl << "Solving obj1 below best solution 1." << endl;
-			min = -__DBL_MAX__;
-			max = bestSSO1.get_objective_score(2);
-		} else {
-			if (verbose) cout << endl << "Solving obj2 below best solution 2." << endl;
-			min = -__DBL_MAX__;
-			max = bestSSO2.get_objective_score(1);
+	if (vm.count("checkpoint-dir")) boost::filesystem::create_directories(MOIP::checkpoint_dir_);
+	if (vm.count("stream")) {
+		streamfile.open(streamName, MOIP::resume_ ? ios::app : ios::out);    // a resumed run adds to it
+		if (not streamfile) {
+			cerr << "\033[31mCannot write to " << streamName << "\033[0m" << endl;
+			return EXIT_FAILURE;
 		}
-		if (verbose)
-			cout << setprecision(-log10(MOIP::precision_) + 4) << "\nSolving objective function " << MOIP::obj_to_solve_
-				 << ", below (or eq. to) " << max << ": Obj" << 3 - MOIP::obj_to_solve_ << "  being in [" << min << ", "
-				 << max << "]..." << endl
-				 << "\t> Forbidding " << F.getSize() << " solutions found in [" << setprecision(10)
-				 << min - MOIP::precision_ << ", " << max + MOIP::precision_ << ']' << endl;
-		myMOIP.search_between(min, max);
+		solution_stream = &streamfile;
+	}
 
-	} catch (IloCplex::Exception& e) {
-		cerr << "\033[31mCplex Exception: " << e.getMessage() << "\033[0m" << endl;
-		exit(EXIT_FAILURE);
+	if (vm.count("serve")) {
+		if (n_jobs < 1) n_jobs = 1;
+		if (n_jobs > 1) verbose = quiet_jobs(verbose);
+		MOIP::n_jobs_ = n_jobs;
+		return serve(socketName, n_jobs, library, theta_p_threshold, obj_function_nbr, verbose);
 	}
 
-	/*  DISPLAY RESULTS  */
+	// load fasta file
+	if (verbose) cout << "Reading input files..." << endl;
+	if (access(inputName.c_str(), F_OK) == -1) {
+		cerr << "\033[31m" << inputName << " not found\033[0m" << endl;
+		return EXIT_FAILURE;
+	}
+	Fasta::load(f, inputName.c_str());
+	if (f.empty()) {
+		cerr << "\033[31m" << inputName << " does not contain any sequence\033[0m" << endl;
+		return EXIT_FAILURE;
+	}
 
-	// print the pareto set
-	if (verbose) {
-		cout << endl << endl << "---------------------------------------------------------------" << endl;
-		cout << "Whole Pareto Set:" << endl;
-		for (uint i = 0; i < myMOIP.get_n_solutions(); i++) myMOIP.solution(i).print();
-		cout << endl;
-		cout << myMOIP.get_n_candidates() << " candidate insertion sites, " << myMOIP.get_n_solutions() << " solutions kept." << endl;
-		cout << "Best value for Motif insertion objective: " << bestSSO1.get_objective_score(1) << endl;
-		cout << "Best value for structure expected accuracy: " << bestSSO2.get_objective_score(2) << endl;
+	// Only the first record is folded, unless --batch is used
+	vector<Fasta> records(f.begin(), f.end());
+	if (not vm.count("batch")) records.resize(1);
+	vector<string> record_files;
+	if (vm.count("outputdir")) {
+		boost::filesystem::create_directories(outputDir);
+		record_files = output_file_names(outputDir, records);
 	}
 
-	// Save it to file
-	if (vm.count("output")) {
+	// Schedule the sequences by decreasing length, so that the longest ones start first
+	vector<size_t> order(records.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	stable_sort(order.begin(), order.end(), [&records](size_t a, size_t b) { return records[a].size() > records[b].size(); });
+
+	vector<string> results(records.size());
+	vector<char>   succeeded(records.size(), 0);
+	atomic<size_t> next_job(0);
+	auto           worker = [&](unsigned int job) {
+		size_t k;
+		while ((k = next_job++) < order.size()) {
+			const Fasta&  fa = records[order[k]];
+			ostringstream out;
+			succeeded[order[k]] = fold_sequence(fa, library, source, motifs_path_name, theta_p_threshold, obj_function_nbr, verbose, job, out);
+			if (vm.count("outputdir")) {
+				ofstream record_file(record_files[order[k]]);
+				record_file << out.str();
+			} else
+				results[order[k]] = out.str();
+		}
+	};
+
+	if (n_jobs < 1) n_jobs = 1;
+	if (n_jobs > records.size()) n_jobs = records.size();
+	if (n_jobs > 1) verbose = quiet_jobs(verbose);
+	MOIP::n_jobs_ = n_jobs;
+	vector<thread> workers;
+	for (unsigned int i = 1; i < n_jobs; i++) workers.push_back(thread(worker, i));
+	worker(0);
+	for (thread& t : workers) t.join();
+
+	// Save the results to file, in the order of the FASTA file
+	if (vm.count("output") and not vm.count("outputdir")) {
 		if (verbose) cout << "Saving structures to " << outputName << "..." << endl;
 		outfile.open(outputName);
-		outfile << fa->name() << endl << fa->seq() << endl;
-		for (uint i = 0; i < myMOIP.get_n_solutions(); i++) outfile << myMOIP.solution(i).to_string() << endl;
+		for (const string& r : results) outfile << r;
 		outfile.close();
 	}
 
+	if (count(succeeded.begin(), succeeded.end(), 0)) {
+		cerr << "\033[31m" << count(succeeded.begin(), succeeded.end(), 0) << " sequence(s) out of " << records.size()
+			 << " could not be folded.\033[0m" << endl;
+		return EXIT_FAILURE;
+	}
+
 	/*  QUIT  */
 
 	return EXIT_SUCCESS;
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 extern "C"
 {
@@ -7,7 +10,6 @@ extern "C"
 #include "rna.h"
 
 
-using namespace Eigen;
 using std::cerr;
 using std::cout;
 using std::endl;
@@ -18,8 +20,7 @@ using std::vector;
 RNA::RNA(void) {}
 
 RNA::RNA(string name, string seq, bool verbose)
-: verbose_{verbose}, name_(name), seq_(seq), n_(seq.size()),
-  pij_(MatrixXf::Zero(n_, n_))
+: verbose_{verbose}, name_(name), seq_(seq), n_(seq.size())
 {
 	vector<char> unknown_chars;
 	bool         contains_T = false;
@@ -53,14 +54,30 @@ RNA::RNA(string name, string seq, bool verbose)
 
 	if (results != NULL)
 	{
-		while (results->i != 0  &&  results->j != 0)
-		{
-			pij_(results->i,results->j) = results->p;
-			results++;
-		}
+		// ViennaRNA numbers the nucleotides from 1
+		for (vrna_ep_t* r = results; r->i != 0 && r->j != 0; r++)
+			if (r->i < r->j and uint(r->j) <= n_)
+				pij_.push_back({ uint(r->i - 1), uint(r->j - 1), r->p });
+		free(results);
 	}
 
 	else cout << "NULL result returned by vrna_pfl_fold" << endl;
+
+	// Index the pairs by their first nucleotide
+	sort(pij_.begin(), pij_.end(), [](const BasePairProb& a, const BasePairProb& b) { return a.i < b.i or (a.i == b.i and a.j < b.j); });
+	pij_.shrink_to_fit();
+	row_start_ = vector<uint>(n_ + 1, 0);
+	for (const BasePairProb& bp : pij_) row_start_[bp.i + 1]++;
+	for (uint i = 0; i < n_; i++) row_start_[i + 1] += row_start_[i];
+}
+
+float RNA::get_pij(int i, int j) const
+{
+	if (i < 0 or uint(i) + 1 >= row_start_.size()) return 0.0;
+	vector<BasePairProb>::const_iterator first = pij_.begin() + row_start_[i];
+	vector<BasePairProb>::const_iterator last  = pij_.begin() + row_start_[i + 1];
+	vector<BasePairProb>::const_iterator it    = lower_bound(first, last, uint(j), [](const BasePairProb& bp, uint j) { return bp.j < j; });
+	return (it != last and it->j == uint(j)) ? it->p : 0.0;
 }
 
 
@@ -72,19 +89,22 @@ void RNA::print_basepair_p_matrix(float theta) const
 	cout << endl;
 	cout << "\t=== -log10(p(i,j)) for each pair (i,j) of nucleotides: ===" << endl << endl;
 	cout << "\t" << seq_ << endl;
-	uint i = 0;
-	for (uint u = 0; u < pij_.rows(); u++) {
+	for (uint u = 0; u < n_; u++) {
 		cout << "\t";
-		for (uint v = 0; v < pij_.cols(); v++) {
-			if (pij_(u, v) < 5e-10)
+		uint v = 0;
+		for (uint k = row_start_[u]; k < row_start_[u + 1]; k++) {
+			const BasePairProb& bp = pij_[k];
+			for (; v < bp.j; v++) cout << " ";
+			if (bp.p < 5e-10)
 				cout << " ";
-			else if (pij_(u, v) > theta)
-				cout << "\033[0;32m" << int(-log10(pij_(u, v))) << "\033[0m";
+			else if (bp.p > theta)
+				cout << "\033[0;32m" << int(-log10(bp.p)) << "\033[0m";
 			else
-				cout << int(-log10(pij_(u, v)));
+				cout << int(-log10(bp.p));
+			v++;
 		}
-		cout << seq_[i] << endl;
-		i++;
+		for (; v < n_; v++) cout << " ";
+		cout << seq_[u] << endl;
 	}
 	cout << endl << "\t\033[0;32mgreen\033[0m basepairs are kept as decision variables." << endl << endl;
 }
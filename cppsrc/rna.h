@@ -2,13 +2,11 @@
 #ifndef DEF_RNA
 #define DEF_RNA
 
-#include <eigen3/Eigen/Core>
 #include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 
-using Eigen::MatrixXf;
 using std::map;
 using std::pair;
 using std::string;
@@ -21,13 +19,19 @@ typedef int base_t;
 #endif
 enum pair_t { PAIR_AU = 0, PAIR_CG, PAIR_GC, PAIR_UA, PAIR_GU, PAIR_UG, PAIR_OTHER = -1 };
 
+typedef struct {
+    uint  i, j;    // 0-based positions of the nucleotides, i < j
+    float p;       // probability that i and j are paired
+} BasePairProb;
+
 class RNA
 {
     public:
     RNA(void);
     RNA(string name, string seq, bool verbose);
 
-    float  get_pij(int i, int j);
+    float  get_pij(int i, int j) const;
+    const vector<BasePairProb>& get_basepair_probabilities(void) const;    // sorted by i, then j
     string get_seq(void) const;
     uint   get_RNA_length(void) const;
     void   print_basepair_p_matrix(float theta) const;
@@ -40,10 +44,13 @@ class RNA
     string   name_;    // name of the rna
     string   seq_;     // sequence of the rna with chars
     uint     n_;       // length of the rna
-    MatrixXf pij_;     // matrix of basepair probabilities
+    // Basepair probabilities above ViennaRNA's cutoff, in compressed sparse rows: the pairs of nucleotide i are
+    // pij_[row_start_[i]] to pij_[row_start_[i+1] - 1]. There are at most max_bp_span of them.
+    vector<BasePairProb> pij_;
+    vector<uint>         row_start_;
 };
 
-inline float  RNA::get_pij(int i, int j) { return pij_(i, j); }
+inline const vector<BasePairProb>& RNA::get_basepair_probabilities(void) const { return pij_; }
 inline uint   RNA::get_RNA_length() const { return n_; }
 inline string RNA::get_seq(void) const { return seq_; }
 
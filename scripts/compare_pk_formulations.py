@@ -0,0 +1,60 @@
+# ============================ IMPORTS ====================================
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+# Compares the two formulations of --disable-pseudoknots (--pk-formulation A and B) on every sequence of a FASTA file:
+# number of pseudoknot rows, wall-clock time and peak memory of biorseo, and whether both find the same Pareto set.
+#
+# usage: python3 scripts/compare_pk_formulations.py <fasta file> <motif option> <motif path> [other biorseo options]
+#   e.g. python3 scripts/compare_pk_formulations.py data/fasta/applications.fa -d data/modules/DESC
+# It runs ./bin/biorseo, from the root of the repository, and exits with 1 if the formulations give different Pareto sets.
+
+if len(sys.argv) < 4:
+	print("usage: python3 scripts/compare_pk_formulations.py <fasta file> <motif option> <motif path> [other biorseo options]")
+	exit(1)
+fasta, motifs, options = sys.argv[1], sys.argv[2:4], sys.argv[4:]
+
+
+def read_fasta(filename):
+	records = []
+	for line in open(filename):
+		line = line.strip()
+		if line.startswith('>'):
+			records.append([line[1:], ""])
+		elif len(records) and len(line):
+			records[-1][1] += line
+	return records
+
+
+def run(formulation, name, seq, folder):
+	# one run of biorseo on one sequence: (pseudoknot rows, seconds, peak kB of RAM, set of structures)
+	query = os.path.join(folder, "query.fa")
+	output = os.path.join(folder, "out_" + formulation + ".txt")
+	log = os.path.join(folder, "log_" + formulation + ".txt")
+	with open(query, 'w') as f:
+		f.write(">" + name + "\n" + seq + "\n")
+	cmd = ["./bin/biorseo", "-s", query, "-o", output, "-n", "--pk-formulation", formulation, "-v"] + motifs + options
+	start = time.time()
+	with open(log, 'w') as f:
+		child = subprocess.Popen(cmd, stdout=f, stderr=subprocess.DEVNULL)
+		_, _, usage = os.wait4(child.pid, 0)    # the resources of this run only
+	seconds = time.time() - start
+	rows = sum(int(n) for n in re.findall(r"^\s*\((\d+) rows\)", open(log).read(), re.MULTILINE))
+	structures = set(open(output).read().split("\n")[2:]) - {""} if os.path.exists(output) else None
+	return rows, seconds, usage.ru_maxrss, structures
+
+
+differences = 0
+print("sequence\tlength\trows A\trows B\ttime A (s)\ttime B (s)\tRAM A (kB)\tRAM B (kB)\tsame Pareto set")
+for name, seq in read_fasta(fasta):
+	with tempfile.TemporaryDirectory() as folder:
+		a = run('A', name, seq, folder)
+		b = run('B', name, seq, folder)
+	same = a[3] is not None and a[3] == b[3]
+	differences += not same
+	print(name, len(seq), a[0], b[0], "%.2f" % a[1], "%.2f" % b[1], a[2], b[2], "yes" if same else "NO", sep='\t')
+exit(1 if differences else 0)
@@ -0,0 +1,112 @@
+# ============================ IMPORTS ====================================
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+# Measures two revisions of biorseo on every sequence of a FASTA file, to back a change with before/after figures:
+# the time define_model() takes to build the CPLEX model and the memory of the CPLEX environment once it is built,
+# the number of solve_objective() calls, the time of the first one (which extracts the model) and the mean time of the
+# others, the wall-clock time and peak memory of the whole run, and whether both revisions find the same Pareto set.
+#
+# Every revision is checked out in a temporary git worktree, where MOIP.cpp gets timers that report on stderr, so that
+# old revisions are measured like new ones, and biorseo runs without -v (printing the constraints would be timed too).
+# Both revisions are built with the Makefile of their own tree, hence CPLEX and ViennaRNA must be installed.
+#
+# usage: python3 scripts/compare_revisions.py <before> <after> <fasta file> <motif option> <motif path> [other options]
+#   e.g. the lean model construction:
+#   python3 scripts/compare_revisions.py 6312884^ 6312884 data/fasta/applications.fa -d data/modules/DESC
+#   or the solver kept across the solves, with MIP starts:
+#   python3 scripts/compare_revisions.py 232421f^ 232421f data/fasta/applications.fa -d data/modules/DESC
+# Run it from the root of the repository. Exits with 1 if the revisions give different Pareto sets.
+
+if len(sys.argv) < 6:
+	print("usage: python3 scripts/compare_revisions.py <before> <after> <fasta file> <motif option> <motif path> [other options]")
+	exit(1)
+revisions, fasta, motifs, options = sys.argv[1:3], os.path.abspath(sys.argv[3]), sys.argv[4:6], sys.argv[6:]
+motifs[1] = os.path.abspath(motifs[1])
+
+# Timers inserted at the start of a function: they report when it returns, however it returns
+timer = "struct BiorseoTimer_ { IloEnv& env; std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); " \
+		"~BiorseoTimer_() { std::cerr << \"#%s \" << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() " \
+		"<< ' ' << env.getMemoryUsage() << std::endl; } } biorseo_timer_{ env_ };"
+instrumented = {"model": r"void MOIP::define_model\(string source\)\s*\{",
+				"solve": r"SecondaryStructure MOIP::solve_objective\(int o, double min, double max[^)]*\)\s*\{"}
+
+
+def read_fasta(filename):
+	records = []
+	for line in open(filename):
+		line = line.strip()
+		if line.startswith('>'):
+			records.append([line[1:], ""])
+		elif len(records) and len(line):
+			records[-1][1] += line
+	return records
+
+
+def build(revision, folder):
+	# checks out the revision in folder, instruments it and builds it, returns the path of its binary
+	subprocess.check_call(["git", "worktree", "add", "--detach", folder, revision], stdout=subprocess.DEVNULL)
+	source = os.path.join(folder, "cppsrc", "MOIP.cpp")
+	code = open(source).read().replace('#include "MOIP.h"', '#include "MOIP.h"\n#include <chrono>\n#include <iostream>', 1)
+	for tag, function in instrumented.items():
+		header = re.search(function, code)
+		if header is None:
+			print("Cannot find", function, "in", revision)
+			exit(1)
+		code = code[:header.end()] + "\n" + (timer % tag) + code[header.end():]
+	open(source, 'w').write(code)
+	subprocess.check_call(["make", "-C", folder, "-j", str(os.cpu_count())], stdout=subprocess.DEVNULL)
+	return os.path.join(folder, "bin", "biorseo")
+
+
+def run(binary, name, seq, folder):
+	# one run on one sequence: (timer lines by tag, seconds, peak kB of RAM, set of structures)
+	query = os.path.join(folder, "query.fa")
+	output = os.path.join(folder, "out.txt")
+	errors = os.path.join(folder, "err.txt")
+	with open(query, 'w') as f:
+		f.write(">" + name + "\n" + seq + "\n")
+	if os.path.exists(output):
+		os.remove(output)
+	start = time.time()
+	with open(errors, 'w') as f:
+		child = subprocess.Popen([binary, "-s", query, "-o", output] + motifs + options, stdout=subprocess.DEVNULL, stderr=f)
+		_, _, usage = os.wait4(child.pid, 0)    # the resources of this run only
+	seconds = time.time() - start
+	timers = {tag: [] for tag in instrumented}
+	for line in open(errors):
+		if line.startswith('#') and line[1:].split()[0] in timers:
+			timers[line[1:].split()[0]].append([float(x) for x in line.split()[1:]])
+	structures = set(open(output).read().split("\n")[2:]) - {""} if os.path.exists(output) else None
+	return timers, seconds, usage.ru_maxrss, structures
+
+
+with tempfile.TemporaryDirectory() as folder:
+	binaries = []
+	try:
+		for i, revision in enumerate(revisions):
+			binaries.append(build(revision, os.path.join(folder, "rev" + str(i))))
+
+		differences = 0
+		print("sequence\tlength\trevision\tmodel built (s)\tCPLEX env (MB)\tsolves\tfirst solve (s)\tnext solves (mean s)\t"
+			  "run (s)\tpeak RAM (kB)\tsame Pareto set")
+		for name, seq in read_fasta(fasta):
+			results = [run(binary, name, seq, folder) for binary in binaries]
+			same = results[0][3] is not None and results[0][3] == results[1][3]
+			differences += not same
+			for revision, (timers, seconds, peak, _) in zip(revisions, results):
+				model = timers["model"][-1] if len(timers["model"]) else [float("nan"), float("nan")]
+				solves = [t[0] for t in timers["solve"]]
+				first = solves[0] if len(solves) else float("nan")
+				next_ones = sum(solves[1:]) / (len(solves) - 1) if len(solves) > 1 else float("nan")
+				print(name, len(seq), revision, "%.3f" % model[0], "%.1f" % (model[1] / 1048576), len(solves), "%.3f" % first,
+					  "%.3f" % next_ones, "%.2f" % seconds, peak, "yes" if same else "NO", sep='\t')
+	finally:
+		for i in range(len(binaries) + 1):
+			subprocess.call(["git", "worktree", "remove", "--force", os.path.join(folder, "rev" + str(i))],
+							stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+exit(1 if differences else 0)
@@ -0,0 +1,139 @@
+/***
+    Checks the binary motif library index (biorseo --compile-library, then --library): a library of DESC or RIN
+    motifs saved and loaded again must hold the same motifs and find the same components, and a truncated index,
+    an index of another version or a file which is not an index must be rejected.
+
+    make test
+***/
+
+#include "MotifLibrary.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+void write_file(const string& name, const string& content) { ofstream(name) << content; }
+
+bool same_motifs(const MotifLibrary& a, const MotifLibrary& b)
+{
+    if (a.get_source() != b.get_source() or a.size() != b.size() or a.get_n_errors() != b.get_n_errors()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        const MotifTemplate &x = a[i], &y = b[i];
+        if (x.file != y.file or x.name != y.name or x.carnaval_id != y.carnaval_id or x.pattern != y.pattern or
+            x.variants != y.variants or x.segment_ids != y.segment_ids or x.segment_gaps != y.segment_gaps or
+            x.component_ids != y.component_ids or x.links.size() != y.links.size())
+            return false;
+        for (size_t l = 0; l < x.links.size(); l++)
+            if (x.links[l].nts != y.links[l].nts or x.links[l].long_range != y.links[l].long_range) return false;
+    }
+    return true;
+}
+
+bool same_hits(const ComponentHits& a, const ComponentHits& b)
+{
+    return a.starts == b.starts and a.lengths == b.lengths and a.slacks == b.slacks and a.rna_length == b.rna_length;
+}
+
+string rejection(const string& index_path)
+{
+    // load_index() exits on an invalid index: load it in a child process, and return what it printed on stderr,
+    // or an empty string if it loaded the index
+    int errors[2];
+    if (pipe(errors) < 0) return "cannot create a pipe";
+    pid_t child = fork();
+    if (child == 0) {
+        dup2(errors[1], STDERR_FILENO);
+        close(errors[0]);
+        MotifLibrary::load_index(index_path, false);
+        _exit(EXIT_SUCCESS);
+    }
+    close(errors[1]);
+    string  message;
+    char    chunk[1024];
+    ssize_t n;
+    while ((n = read(errors[0], chunk, sizeof(chunk))) > 0) message.append(chunk, n);
+    close(errors[0]);
+    int status;
+    waitpid(child, &status, 0);
+    if (WIFEXITED(status) and WEXITSTATUS(status) == EXIT_SUCCESS) return "";
+    return message.empty() ? "rejected without a message" : message;
+}
+
+int main(void)
+{
+    int fails = 0;
+
+    auto expect = [&fails](bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << endl;
+            fails++;
+        }
+    };
+
+    char folder[] = "/tmp/biorseo_library_test_XXXXXX";
+    if (mkdtemp(folder) == nullptr) {
+        cerr << "FAILED: cannot create a temporary folder" << endl;
+        return EXIT_FAILURE;
+    }
+    string root(folder);
+    string desc = root + "/DESC", rin = root + "/CaRNAval/Subfiles";
+    system(("mkdir -p " + desc + " " + rin).c_str());
+
+    // Two components, one of them extended to a window; a gapped motif; an invalid nucleotide
+    write_file(desc + "/1GID_A-1.desc", "id: 1\nBases: 10_G  11_C  12_A  20_U  \n( 10_G ) C/C ( 11_C )\n");
+    write_file(desc + "/1GID_A-2.desc", "id: 2\nBases: 3_A  5_G  6_G  7_U  30_A  31_C  32_C  \n");
+    write_file(desc + "/1GID_A-3.desc", "id: 3\nBases: 3_A  4_X  5_G  \n");
+    write_file(rin + "/0.txt", "ntA,ntB,long_range;...\n0,5,False;1,4,False;\npos;k;seq\n0,2;3;GCA\n9,11;3;UGC\n");
+    write_file(rin + "/1.txt", "ntA,ntB,long_range;...\n0,3,True;\npos;k;seq\n0,1;2;GG\n6,8;3;UUC\n");
+
+    const string rna = "GGCAUAGGUAACCAGCAUUGCUUCGCACGCAUGCAAGGUGCAAUUACCGCAGGAAUUUCGGGCAAUGCAUUGCA";
+
+    for (const string& source : { string("descfolder"), string("rinfolder") }) {
+        MotifLibrary library(source, source == "descfolder" ? desc : root + "/CaRNAval", false);
+        string       index = root + "/" + source + ".idx";
+        library.save_index(index);
+        MotifLibrary loaded = MotifLibrary::load_index(index, false);
+        expect(library.size() == 2 and library.get_n_errors() == (source == "descfolder" ? 1u : 0u), "the " + source + " test library is read");
+        expect(same_motifs(library, loaded), "the " + source + " motifs are the same once saved and loaded");
+        ComponentHits hits = loaded.scan(rna);
+        expect(any_of(hits.starts.begin(), hits.starts.end(), [](const vector<uint>& s) { return s.size(); }), "the " + source + " components are found");
+        expect(same_hits(library.scan(rna), hits), "the " + source + " components are found at the same places once loaded");
+        expect(same_hits(library.scan(""), loaded.scan("")), "the " + source + " index also scans an empty sequence");
+    }
+
+    // Invalid indexes
+    string index = root + "/descfolder.idx";
+    string content;
+    {
+        ifstream f(index, ios::binary);
+        content.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+    }
+    expect(rejection(index).empty(), "a valid index is loaded");
+
+    write_file(root + "/truncated.idx", content.substr(0, content.size() - 1));
+    expect(rejection(root + "/truncated.idx").find("is truncated") != string::npos, "an index missing its last byte is rejected");
+    write_file(root + "/header.idx", content.substr(0, 20));
+    expect(rejection(root + "/header.idx").find("can't read") != string::npos, "an index shorter than its header is rejected");
+    write_file(root + "/longer.idx", content + '\0');
+    expect(rejection(root + "/longer.idx").find("is truncated or corrupted") != string::npos, "an index with trailing bytes is rejected");
+
+    string other_version = content;
+    other_version[8] += 1;    // the version follows the 8 bytes of the magic number
+    write_file(root + "/version.idx", other_version);
+    expect(rejection(root + "/version.idx").find("not a motif library index compiled by this version") != string::npos,
+           "an index of another version is rejected");
+    write_file(root + "/text.idx", string(content.size(), 'A'));
+    expect(rejection(root + "/text.idx").find("not a motif library index") != string::npos, "a file which is not an index is rejected");
+    expect(rejection(root + "/missing.idx").find("can't read") != string::npos, "a missing index is rejected");
+
+    system(("rm -rf " + root).c_str());
+
+    if (fails) return EXIT_FAILURE;
+    cout << "library_test: OK" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/***
+    Checks ParetoArchive against the brute-force Pareto set it replaced, which compares a new structure with every
+    structure kept so far. The archive only compares it with its neighbours in the order of objective 1, and stops
+    its walks 2 * MOIP::precision_ away from it: random objective values, many of them closer than the precision or
+    just beyond it, must give the same answers and the same set of structures.
+
+    make test
+***/
+
+#include "MOIP.h"
+#include "ParetoArchive.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+
+using namespace std;
+
+
+SecondaryStructure structure(double obj1, double obj2, size_t id)
+{
+    SecondaryStructure s(false);
+    s.objective_scores_ = { obj1, obj2 };
+    s.hash_             = id;
+    return s;
+}
+
+bool brute_force_dominated(const vector<SecondaryStructure>& front, const SecondaryStructure& s)
+{
+    return any_of(front.begin(), front.end(), [&s](const SecondaryStructure& x) { return x > s; });
+}
+
+bool brute_force_insert(vector<SecondaryStructure>& front, const SecondaryStructure& s)
+{
+    if (brute_force_dominated(front, s)) return false;
+    front.erase(remove_if(front.begin(), front.end(), [&s](const SecondaryStructure& x) { return s > x; }), front.end());
+    front.push_back(s);
+    return true;
+}
+
+set<size_t> ids(const vector<SecondaryStructure>& front)
+{
+    set<size_t> h;
+    for (const SecondaryStructure& s : front) h.insert(s.hash_);
+    return h;
+}
+
+set<size_t> ids(const ParetoArchive& archive)
+{
+    set<size_t> h;
+    for (const SecondaryStructure& s : archive) h.insert(s.hash_);
+    return h;
+}
+
+int main(void)
+{
+    int fails = 0;
+
+    auto expect = [&fails](bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << endl;
+            fails++;
+        }
+    };
+
+    const double eps = MOIP::precision_;
+
+    // Hand-written ties
+    ParetoArchive archive(eps);
+    expect(archive.insert(structure(1, 2, 1)), "the first structure is kept");
+    expect(archive.insert(structure(1 + 0.5 * eps, 2 - 0.5 * eps, 2)), "a structure tied on both objectives is kept");
+    expect(not archive.insert(structure(1, 2 - 1.5 * eps, 3)), "a structure tied on objective 1 and worse on objective 2 is dominated");
+    expect(archive.insert(structure(1, 2 + 1.5 * eps, 4)) and archive.size() == 1, "a structure tied on objective 1 and better on objective 2 replaces both");
+    expect(archive.insert(structure(2, 1, 5)) and archive.size() == 2, "a trade-off is kept");
+
+    // Random fronts in a few eps, where most pairs are tied or nearly tied on some objective. Half of the values are
+    // within 0.05 eps of a multiple of eps, the boundaries of the walks. (A difference of exactly eps is neither a tie
+    // nor an improvement for operator>, the brute force gives no reference there: the values are real numbers.)
+    mt19937                          g(1);
+    uniform_real_distribution<double> uniform(0, 1);
+    size_t                           compared = 0, kept = 0;
+    for (int trial = 0; trial < 2000; trial++) {
+        ParetoArchive              archive(eps);
+        vector<SecondaryStructure> front;
+        size_t                     range = 2 + g() % 10;    // in eps
+        auto                       value = [&]() {
+            if (g() % 2) return (g() % range + 0.1 * uniform(g) - 0.05) * eps;
+            return range * uniform(g) * eps;
+        };
+        for (size_t id = 0; id < 200; id++) {
+            double obj1 = value(), obj2 = value();
+            if (g() % 4 == 0) obj2 = range * eps - obj1;    // on an anti-diagonal, a trade-off with many others
+            SecondaryStructure s = structure(obj1, obj2, id);
+            if (archive.is_dominated(s) != brute_force_dominated(front, s)) {
+                expect(false, "is_dominated() of (" + to_string(obj1 / eps) + ", " + to_string(obj2 / eps) + ") eps");
+                break;
+            }
+            if (archive.insert(s) != brute_force_insert(front, s) or ids(archive) != ids(front)) {
+                expect(false, "insert() of (" + to_string(obj1 / eps) + ", " + to_string(obj2 / eps) + ") eps");
+                break;
+            }
+            compared++;
+        }
+        kept += archive.size();
+    }
+    expect(compared == 2000 * 200, "every insertion compared");
+    expect(kept > 2000, "fronts of several structures");
+
+    if (fails) return EXIT_FAILURE;
+    cout << "pareto_test: OK" << endl;
+    return EXIT_SUCCESS;
+}
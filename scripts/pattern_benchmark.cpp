@@ -0,0 +1,115 @@
+/***
+    Throughput of the motif component search: std::regex, as biorseo used to place DESC motifs, against the
+    MotifScanner automaton and find_next_ones_in(). Random motifs of 1 to 3 components (nucleotides and '.'
+    wildcards) are placed on every sequence of a FASTA file, and both paths must find the same placements.
+
+    make benchmark
+    bin/pattern_benchmark [fasta file] [number of motifs] [random seed]
+
+    With the defaults (2000 motifs, seed 1), both paths find 1071 placements on data/fasta/applications.fa.
+***/
+
+#include "Motif.h"
+#include "MotifScanner.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <regex>
+
+using namespace std;
+
+
+size_t regex_placements(const string& rna, uint offset, const vector<regex>& vc, size_t d)
+{
+    // The recursion biorseo used before the scanner: successive regex searches, every component at least
+    // 4 nucleotides after the previous one, on the rest of the sequence
+    size_t n = 0;
+    for (sregex_iterator i(rna.begin(), rna.end(), vc[d]); i != sregex_iterator(); ++i) {
+        if (d + 1 == vc.size()) {
+            n++;
+            continue;
+        }
+        size_t end = i->position() + i->length() - 1;
+        if (end + 5 >= rna.length()) continue;
+        n += regex_placements(rna.substr(end + 5), offset + end + 5, vc, d + 1);
+    }
+    return n;
+}
+
+int main(int argc, char* argv[])
+{
+    string   fasta    = (argc > 1) ? argv[1] : "data/fasta/applications.fa";
+    size_t   n_motifs = (argc > 2) ? atoi(argv[2]) : 2000;
+    unsigned seed     = (argc > 3) ? atoi(argv[3]) : 1;
+
+    // sequences
+    vector<string> rnas;
+    std::ifstream  file(fasta);
+    string         line;
+    while (getline(file, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '>')
+            rnas.push_back("");
+        else if (rnas.size())
+            rnas.back() += line;
+    }
+    size_t n_nt = 0;
+    for (const string& rna : rnas) n_nt += rna.size();
+    if (!n_nt) {
+        cerr << "No sequence in " << fasta << endl;
+        return EXIT_FAILURE;
+    }
+
+    // motifs
+    mt19937              g(seed);
+    vector<vector<string>> motifs(n_motifs);
+    for (vector<string>& m : motifs) {
+        m.resize(1 + g() % 3);
+        for (string& c : m) {
+            c = string(3 + g() % 6, '.');
+            for (size_t i = 0; i < c.size(); i++)
+                if (i == 0 or i + 1 == c.size() or g() % 4) c[i] = "ACGU"[g() % 4];
+        }
+    }
+
+    // std::regex: compiled per motif and component, like the former find_next_ones_in()
+    auto   t0        = chrono::steady_clock::now();
+    size_t n_regex   = 0;
+    for (const string& rna : rnas)
+        for (const vector<string>& m : motifs) {
+            vector<regex> vc;
+            for (const string& c : m) vc.push_back(regex(c));
+            n_regex += regex_placements(rna, 0, vc, 0);
+        }
+    auto t1 = chrono::steady_clock::now();
+
+    // the scanner, built once for the library, then one pass per sequence
+    MotifScanner         scanner;
+    vector<vector<uint>> ids(n_motifs);
+    for (size_t k = 0; k < n_motifs; k++)
+        for (const string& c : motifs[k]) ids[k].push_back(scanner.add_pattern(c));
+    scanner.build();
+    auto   t2        = chrono::steady_clock::now();
+    size_t n_scanner = 0;
+    for (const string& rna : rnas) {
+        ComponentHits hits = scanner.scan(rna);
+        for (const vector<uint>& vc : ids)
+            find_next_ones_in(hits, vc, [](const vector<Component>&, size_t) { return true; }, [&n_scanner](const vector<Component>&) { n_scanner++; });
+    }
+    auto t3 = chrono::steady_clock::now();
+
+    double regex_ms   = chrono::duration<double, milli>(t1 - t0).count();
+    double build_ms   = chrono::duration<double, milli>(t2 - t1).count();
+    double scanner_ms = chrono::duration<double, milli>(t3 - t2).count();
+    cout << rnas.size() << " sequences (" << n_nt << " nt), " << n_motifs << " motifs" << endl;
+    cout << "std::regex: " << regex_ms << " ms, " << n_motifs * n_nt / regex_ms / 1e3 << " Mnt/s, " << n_regex << " placements" << endl;
+    cout << "scanner:    " << scanner_ms << " ms (+ " << build_ms << " ms to build it), " << n_motifs * n_nt / scanner_ms / 1e3
+         << " Mnt/s, " << n_scanner << " placements" << endl;
+    if (n_regex != n_scanner) {
+        cerr << "The two paths disagree" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,177 @@
+/***
+    Checks the motif component search against std::regex, which biorseo used to place the motifs before the scanner:
+    GappedPattern, the MotifScanner automaton, and the enumeration of find_next_ones_in().
+    Hand-written edge cases (overlapping matches, windows '~n' at the ends of the sequence, patterns longer than it,
+    wildcards only), then random motifs on random sequences, must give the same placements as the regex oracle.
+
+    make test
+***/
+
+#include "GappedPattern.h"
+#include "Motif.h"
+#include "MotifScanner.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <set>
+
+using namespace std;
+
+typedef vector<pair<uint, uint>> Placement;    // (first, last) nucleotide of every component
+
+
+vector<string> variants(const string& component)
+{
+    // 'X~n' stands for X at every offset in a window of n nucleotides, a component without '~' for itself
+    size_t tilde = component.find('~');
+    if (tilde == string::npos) return { component };
+    string core   = component.substr(0, tilde);
+    size_t window = stoul(component.substr(tilde + 1));
+    if (window <= core.size()) return { core };
+    vector<string> v;
+    for (size_t offset = 0; offset + core.size() <= window; offset++)
+        v.push_back(string(offset, '.') + core + string(window - core.size() - offset, '.'));
+    return v;
+}
+
+void regex_placements(const string& rna, uint from, const vector<string>& components, size_t d, Placement& current, set<Placement>& found)
+{
+    // The former search: successive regex searches on the rest of the sequence, every component at least 4 nucleotides
+    // after the previous one. The placements of an extended component are the union of those of its variants.
+    if (from > rna.size()) return;
+    string    rest = rna.substr(from);
+    set<uint> starts;
+    size_t    length = variants(components[d])[0].size();
+    for (const string& v : variants(components[d])) {
+        regex r(v);
+        for (sregex_iterator i(rest.begin(), rest.end(), r); i != sregex_iterator(); ++i) starts.insert(from + i->position());
+    }
+    for (uint start : starts) {
+        current.push_back(make_pair(start, uint(start + length - 1)));
+        if (d + 1 == components.size())
+            found.insert(current);
+        else
+            regex_placements(rna, start + length + 4, components, d + 1, current, found);
+        current.pop_back();
+    }
+}
+
+set<Placement> oracle(const string& rna, const vector<string>& components)
+{
+    set<Placement> found;
+    Placement      current;
+    regex_placements(rna, 0, components, 0, current, found);
+    return found;
+}
+
+set<Placement> scanner_placements(const string& rna, const vector<string>& components)
+{
+    MotifScanner scanner;
+    vector<uint> ids;
+    for (const string& c : components) ids.push_back(scanner.add_pattern(c));
+    scanner.build();
+    ComponentHits  hits = scanner.scan(rna);
+    set<Placement> found;
+    size_t         emitted = 0;
+    find_next_ones_in(hits, ids, [](const vector<Component>&, size_t) { return true; },
+    [&](const vector<Component>& v) {
+        Placement p;
+        for (const Component& c : v) p.push_back(c.pos);
+        found.insert(p);
+        emitted++;
+    });
+    if (emitted != found.size()) found.insert(Placement(1, make_pair(uint(-1), uint(-1))));    // a placement emitted twice
+    return found;
+}
+
+string describe(const string& rna, const vector<string>& components)
+{
+    string s = rna + " /";
+    for (const string& c : components) s += " " + c;
+    return s;
+}
+
+int main(void)
+{
+    int fails = 0;
+
+    auto expect = [&fails](bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << endl;
+            fails++;
+        }
+    };
+    auto same_as_regex = [&expect](const string& rna, const vector<string>& components) {
+        expect(scanner_placements(rna, components) == oracle(rna, components), "same placements as std::regex for " + describe(rna, components));
+    };
+    auto expect_starts = [&expect](const string& rna, const string& component, const set<uint>& starts) {
+        set<uint> found;
+        for (const Placement& p : scanner_placements(rna, { component })) found.insert(p[0].first);
+        expect(found == starts, "expected starts of " + describe(rna, { component }));
+    };
+
+    // GappedPattern
+    GappedPattern gapped("AC.{5,}G.U");
+    expect(gapped.get_segments() == vector<string>({ "AC", "G.U" }), "the segments of AC.{5,}G.U");
+    expect(gapped.get_min_gaps() == vector<size_t>({ 5 }), "the gap of AC.{5,}G.U");
+    expect(gapped.length() == 2 and gapped.window() == 2, "only the first segment is matched");
+    expect(gapped.matches_at("GGAC", 2), "AC matches at the very end of the sequence");
+    expect(not gapped.matches_at("GGAC", 3), "AC does not match past the end of the sequence");
+    GappedPattern extended("G~3");
+    expect(extended.length() == 1 and extended.window() == 3, "G~3 is G, in a window of 3");
+    GappedPattern wildcard(".A");
+    expect(wildcard.matches_at("NA", 0), "a wildcard matches any character");
+    expect(not GappedPattern("A").matches_at("N", 0), "a nucleotide only matches itself");
+
+    // MotifScanner
+    MotifScanner scanner;
+    expect(scanner.add_pattern("ACG") == scanner.add_pattern("ACG"), "a pattern added twice has a single id");
+    expect(scanner.add_pattern("AC") != scanner.add_pattern("ACG"), "a prefix is another pattern");
+    expect(scanner.size() == 2, "two distinct patterns");
+
+    // Overlapping matches: like successive regex searches, the placements of a component do not overlap
+    expect_starts("AAAAA", "AA", { 0, 2 });
+    expect_starts("ACACAC", "ACA", { 0 });
+    expect_starts("GAGAGAG", "G.G", { 0, 4 });
+    same_as_regex("AAAAAAAAAAAAAA", { "AA", "AAA" });
+
+    // Windows '~n' at the boundaries of the sequence, and patterns shorter or longer than the window
+    expect_starts("AAG", "G~3", { 0 });
+    expect_starts("GAA", "G~3", { 0 });
+    expect_starts("AG", "G~3", {});
+    expect_starts("AAAA", "A~3", { 0 });
+    expect_starts("CCGCC", "G~3", { 0, 1, 2 });
+    expect_starts("GCAU", "GCAU~2", { 0 });
+    expect_starts("GCA", "GCAU", {});
+    expect_starts("", "A", {});
+    same_as_regex("UUGUUUUUUUG", { "G~3", "G~2" });
+    same_as_regex("GUUUUUG", { "G~4", "G~3" });
+
+    // Wildcards only: there is no anchor for the automaton, every position is tested
+    expect_starts("ACGUA", "...", { 0 });
+    same_as_regex("ACGUNACGU", { "..", ".N." });
+
+    // Components at least 4 nucleotides apart
+    same_as_regex("GCAAAAGC", { "GC", "GC" });
+    same_as_regex("GCAAAGC", { "GC", "GC" });
+
+    // Random motifs on random sequences, with an unknown nucleotide here and there
+    mt19937 g(1);
+    for (int trial = 0; trial < 3000; trial++) {
+        string rna(g() % 40, 'A');
+        for (char& c : rna) c = (g() % 50) ? "ACGU"[g() % 4] : 'N';
+        vector<string> components(1 + g() % 3);
+        for (string& c : components) {
+            c = string(1 + g() % 4, '.');
+            for (char& nt : c)
+                if (g() % 3) nt = "ACGU"[g() % 4];
+            if (g() % 4 == 0) c += "~" + to_string(1 + g() % 6);
+        }
+        same_as_regex(rna, components);
+    }
+
+    if (fails) return EXIT_FAILURE;
+    cout << "pattern_test: OK" << endl;
+    return EXIT_SUCCESS;
+}
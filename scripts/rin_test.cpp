@@ -0,0 +1,109 @@
+/***
+    Checks the placements of CaRNAval RINs: those found in the reversed RNA must be stored in the coordinates of the
+    RNA like the others, so that the links of the RIN (nt_position()), the c3 exemptions and the c6 constraints point
+    to the nucleotides the RIN was matched on.
+
+    make test
+***/
+
+#include "Motif.h"
+#include "MotifScanner.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+
+vector<Motif> placements(const string& rna, const MotifTemplate& rin, bool reversed)
+{
+    // Where the RIN can be placed, like MOIP::allowed_motifs_from_rin() (without its basepair checks)
+    MotifScanner scanner;
+    vector<uint> ids;
+    for (const string& c : rin.variants[0]) ids.push_back(scanner.add_pattern(c));
+    scanner.build();
+    string scanned = rna;
+    if (reversed) reverse(scanned.begin(), scanned.end());
+    vector<Motif> sites;
+    find_next_ones_in(scanner.scan(scanned), ids, [](const vector<Component>&, size_t) { return true; },
+    [&](const vector<Component>& v) { sites.push_back(Motif(v, rin, reversed, rna.size())); });
+    return sites;
+}
+
+bool on_its_nucleotides(const string& rna, const MotifTemplate& rin, const Motif& m)
+{
+    // The components are in the order of the RNA, hold the nucleotides they were matched on,
+    // and every nucleotide of the RIN, in the numbering of its links, is placed on the nucleotide it stands for
+    string all = "";
+    for (const string& c : rin.variants[0]) all += c;
+    for (size_t j = 0; j < m.comp.size(); j++) {
+        const Component& c = m.comp[j];
+        if (c.pos.second >= rna.size() or c.pos.second + 1 - c.pos.first != c.k or rna.substr(c.pos.first, c.k) != c.seq_) return false;
+        if (j and m.comp[j - 1].pos.second >= c.pos.first) return false;
+    }
+    for (uint nt = 0; nt < all.size(); nt++)
+        if (m.nt_position(nt) >= rna.size() or rna[m.nt_position(nt)] != all[nt]) return false;
+    return m.nt_position(all.size()) == size_t(-1);
+}
+
+int main(void)
+{
+    int fails = 0;
+
+    auto expect = [&fails](bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << endl;
+            fails++;
+        }
+    };
+
+    MotifTemplate rin;
+    rin.carnaval_id = 1;
+    rin.variants    = { { "GCA", "UGC" } };
+    rin.links       = { { make_pair(0u, 5u), false }, { make_pair(1u, 4u), false } };
+
+    // The RIN only matches the reversed RNA: GCA.....UGC read from the end
+    string        rna = "AACGUAAAAACG";
+    vector<Motif> forward = placements(rna, rin, false), reversed = placements(rna, rin, true);
+    expect(forward.empty() and reversed.size() == 1, "one reversed placement of GCA,UGC in AACGUAAAAACG");
+    if (reversed.size() == 1) {
+        const Motif& m = reversed[0];
+        expect(m.reversed_, "the placement is reversed");
+        expect(m.comp[0].pos == make_pair(2u, 4u) and m.comp[1].pos == make_pair(9u, 11u), "its components are in the coordinates of the RNA");
+        expect(m.comp[0].seq_ == "CGU" and m.comp[1].seq_ == "ACG", "its components hold the nucleotides of the RNA");
+        expect(m.comp_index(0) == 1 and m.comp_index(1) == 0, "the first component of the RIN is the last one in the RNA");
+        expect(m.nt_position(0) == 11 and m.nt_position(5) == 2, "the link 0-5 is placed on the pair 2-11");
+        expect(m.nt_position(1) == 10 and m.nt_position(4) == 3, "the link 1-4 is placed on the pair 3-10");
+        expect(m.nt_position(6) == size_t(-1), "no nucleotide beyond the components");
+        expect(on_its_nucleotides(rna, rin, m), "the reversed placement is on the nucleotides it was matched on");
+    }
+
+    // The same RIN in the RNA itself
+    forward = placements("GCAAAAAUGC", rin, false);
+    expect(forward.size() == 1 and forward[0].comp[0].pos == make_pair(0u, 2u) and forward[0].nt_position(5) == 9, "the forward placement is unchanged");
+
+    // Random RINs on random RNAs
+    mt19937 g(1);
+    size_t  n_reversed = 0;
+    for (int trial = 0; trial < 2000; trial++) {
+        string rna(20 + g() % 40, 'A');
+        for (char& c : rna) c = "ACGU"[g() % 4];
+        MotifTemplate random_rin;
+        random_rin.variants = vector<vector<string>>(1, vector<string>(1 + g() % 3));
+        for (string& c : random_rin.variants[0]) {
+            c = string(1 + g() % 3, 'A');
+            for (char& nt : c) nt = "ACGU"[g() % 2 ? g() % 4 : 0];
+        }
+        for (bool r : { false, true })
+            for (const Motif& m : placements(rna, random_rin, r)) {
+                expect(on_its_nucleotides(rna, random_rin, m), "placement of a random RIN on " + rna);
+                n_reversed += r;
+            }
+    }
+    expect(n_reversed > 0, "random RINs are placed in reversed RNAs");
+
+    if (fails) return EXIT_FAILURE;
+    cout << "rin_test: OK" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+/***
+    Checks the basepair probabilities RNA reads from ViennaRNA: they are indexed from 0, like the sequence.
+    The hairpin GACUGCGAAAGCAGUC folds as a 6 basepair stem, (0,15) to (5,10), closed by a GAAA tetraloop:
+    these pairs are the most probable by far. Read one nucleotide off, they would be found unpaired, and
+    non-canonical pairs like (1,15), A-C, would get a probability.
+
+    make test
+***/
+
+#include "rna.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+
+int main(void)
+{
+    RNA  hairpin("hairpin", "GACUGCGAAAGCAGUC", false);
+    uint n     = hairpin.get_RNA_length();
+    int  fails = 0;
+
+    auto expect = [&fails](bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << endl;
+            fails++;
+        }
+    };
+
+    expect(hairpin.get_pij(0, n - 1) > 0.5, "the closing pair (0,15), G-C, is probable");
+    expect(hairpin.get_pij(2, n - 3) > 0.5, "the pair (2,13) of the stem, C-G, is probable");
+    expect(hairpin.get_pij(1, n - 1) == 0.0, "the pair (1,15), A-C, cannot form");
+    for (const BasePairProb& bp : hairpin.get_basepair_probabilities())
+        expect(bp.i < bp.j and bp.j < n, "every pair is inside the sequence");
+
+    if (fails) return EXIT_FAILURE;
+    cout << "rna_test: OK" << endl;
+    return EXIT_SUCCESS;
+}
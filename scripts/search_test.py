@@ -0,0 +1,167 @@
+# ============================ IMPORTS ====================================
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+# Checks the Pareto searches of ./bin/biorseo on data/fasta/applications.fa, against a serial run of the same search:
+# sequences folded concurrently (--jobs) and fronts explored by several solvers (--solvers) must find the same Pareto
+# sets, a search whose solves are cut short by --solve-time-limit keeps no unproven solution, hence only points of
+# the Pareto front, and a search interrupted then continued from its checkpoint (--resume) finds the Pareto sets of
+# an uninterrupted one. A checkpoint of another sequence or of other insertion sites must be rejected.
+#
+# The motifs are cut out of the sequences themselves, so that every sequence has insertion sites. As the searches
+# run on CPLEX, this test needs the built biorseo.
+#
+# usage: python3 scripts/search_test.py (make test), from the root of the repository
+
+fasta = "data/fasta/applications.fa"
+precision = 1e-5    # MOIP::precision_
+fails = 0
+
+
+def expect(ok, what):
+	global fails
+	if not ok:
+		print("FAILED:", what, file=sys.stderr)
+		fails += 1
+
+
+def read_fasta(filename):
+	records = []
+	for line in open(filename):
+		line = line.strip()
+		if line.startswith('>'):
+			records.append([line[1:], ""])
+		elif len(records) and len(line):
+			records[-1][1] += line
+	return records
+
+
+def write_motifs(folder):
+	# Two-component motifs, each of 4 nucleotides, 12 nucleotides apart in one of the sequences, in DESC format
+	n = 0
+	for _, seq in read_fasta(fasta):
+		seq = seq.upper()
+		for i in range(0, len(seq) - 20, 12):
+			n += 1
+			bases = [str(p + 1) + '_' + seq[p] for p in list(range(i, i + 4)) + list(range(i + 12, i + 16))]
+			with open(os.path.join(folder, "1TST_A-" + str(n) + ".desc"), 'w') as f:
+				f.write("id: " + str(n) + "\nBases: " + "  ".join(bases) + "  \n")
+
+
+def start(folder, label, options):
+	# one --batch run of biorseo, with one result file per sequence, and its messages in <label>.log
+	with open(os.path.join(folder, label + ".log"), 'w') as log:
+		return subprocess.Popen(["./bin/biorseo", "-s", fasta, "--batch", "-d", os.path.join(folder, "DESC"), "--outputdir",
+								 os.path.join(folder, label), "--status-comments"] + options, stdout=log, stderr=subprocess.STDOUT)
+
+
+def run(folder, label, options):
+	# a run of biorseo to its end: {file: (status comment, set of structures)}
+	start(folder, label, options).wait()
+	output = os.path.join(folder, label)
+	results = {}
+	for name in sorted(os.listdir(output)) if os.path.isdir(output) else []:
+		lines = open(os.path.join(output, name)).read().split("\n")
+		status = lines.pop(0)[2:] if lines[0].startswith("# ") else ""
+		results[name] = (status, set(lines[2:]) - {""})
+	return results
+
+
+def checkpoints(folder):
+	return sorted(name for name in os.listdir(folder) if not name.endswith(".tmp"))
+
+
+def tamper(folder, field, change):
+	# changes one field of the first line of every checkpoint in folder: biorseo-checkpoint version key sequence sites
+	for name in checkpoints(folder):
+		lines = open(os.path.join(folder, name)).read().split("\n")
+		header = lines[0].split(' ')
+		header[field] = change(header[field])
+		lines[0] = ' '.join(header)
+		open(os.path.join(folder, name), 'w').write("\n".join(lines))
+
+
+def points(structures):
+	# the objective values of the structures
+	return [tuple(float(x) for x in s.split('\t')[1:3]) for s in structures]
+
+
+def on_front(p, front):
+	# whether p is one of the points of front, up to the precision of the search
+	return any(abs(p[0] - q[0]) <= 2 * precision and abs(p[1] - q[1]) <= 2 * precision for q in front)
+
+
+with tempfile.TemporaryDirectory() as folder:
+	os.mkdir(os.path.join(folder, "DESC"))
+	write_motifs(os.path.join(folder, "DESC"))
+
+	serial = run(folder, "serial", [])
+	expect(len(serial) == len(read_fasta(fasta)), "one result per sequence of " + fasta)
+	for name, (status, structures) in serial.items():
+		expect(status == "" and len(structures) > 0, name + ": the serial search is complete")
+
+	# Concurrent searches: the same structures with --jobs, each sequence being searched as in the serial run. Several
+	# solvers may find other structures of the same scores when some tie, the Pareto front is the same.
+	jobs = run(folder, "jobs", ["--jobs", "3"])
+	expect(jobs == serial, "the same Pareto sets with --jobs 3")
+	for solvers in ["2", "3"]:
+		parallel = run(folder, "solvers" + solvers, ["--solvers", solvers])
+		expect(parallel.keys() == serial.keys(), "one result per sequence with --solvers " + solvers)
+		for name, (status, structures) in parallel.items():
+			front = points(serial[name][1])
+			expect(status == "" and len(structures) == len(front) and all(on_front(p, front) for p in points(structures)),
+				   name + ": the same Pareto front with --solvers " + solvers)
+
+	# Solves cut short: the records they stopped hold no unproven solution, the others are the same
+	cut = run(folder, "cut", ["--solve-time-limit", "0.005", "--checkpoint-dir", os.path.join(folder, "cut_checkpoints")])
+	expect(any("solve time limit reached" in status for status, _ in cut.values()), "--solve-time-limit 0.005 cuts some solves short")
+	for name, (status, structures) in cut.items():
+		if status:
+			front = points(serial[name][1])
+			expect(all(on_front(p, front) for p in points(structures)), name + ": the solves cut short only keep Pareto points")
+		else:
+			expect(structures == serial[name][1], name + ": the same Pareto set when no solve is cut short")
+
+	# Continued from checkpoints: the intervals left by the solves cut short, by a solution limit, by a kill
+	expect(checkpoints(os.path.join(folder, "cut_checkpoints")), "the solves cut short leave checkpoints")
+	expect(run(folder, "cut_resumed", ["--checkpoint-dir", os.path.join(folder, "cut_checkpoints"), "--resume"]) == serial,
+		   "the same Pareto sets once the solves cut short are resumed")
+
+	limited_checkpoints = os.path.join(folder, "limited_checkpoints")
+	limited = run(folder, "limited", ["-l", "1", "--checkpoint-dir", limited_checkpoints])
+	expect(any(status for status, _ in limited.values()), "-l 1 stops some searches")
+	expect(len(checkpoints(limited_checkpoints)) == sum(status != "" for status, _ in limited.values()), "one checkpoint per search stopped")
+	for label, field, change in [("other_sequence", 3, lambda seq: ("C" if seq[0] == "A" else "A") + seq[1:]),
+								 ("other_sites", 4, lambda n: str(int(n) + 1))]:
+		shutil.copytree(limited_checkpoints, os.path.join(folder, label))
+		tamper(os.path.join(folder, label), field, change)
+	expect(run(folder, "limited_resumed", ["--checkpoint-dir", limited_checkpoints, "--resume"]) == serial,
+		   "the same Pareto sets once the searches stopped by -l 1 are resumed")
+	expect(not checkpoints(limited_checkpoints), "the checkpoints of the searches completed are removed")
+
+	killed_checkpoints = os.path.join(folder, "killed_checkpoints")
+	os.mkdir(killed_checkpoints)
+	child = start(folder, "killed", ["--checkpoint-dir", killed_checkpoints, "--checkpoint-interval", "0"])
+	while child.poll() is None and not checkpoints(killed_checkpoints):
+		time.sleep(0.01)
+	child.kill()    # no chance to save anything more
+	child.wait()
+	expect(run(folder, "killed_resumed", ["--checkpoint-dir", killed_checkpoints, "--resume"]) == serial,
+		   "the same Pareto sets once the killed run is resumed")
+
+	# A checkpoint of another problem: rejected, and the search starts from scratch
+	for label in ["other_sequence", "other_sites"]:
+		n_checkpoints = len(checkpoints(os.path.join(folder, label)))    # removed once the searches are complete
+		resumed = run(folder, label + "_resumed", ["--checkpoint-dir", os.path.join(folder, label), "--resume"])
+		log = open(os.path.join(folder, label + "_resumed.log")).read()
+		expect(n_checkpoints > 0 and log.count("is not a checkpoint of this problem") == n_checkpoints,
+			   "the checkpoints with " + label.replace('_', ' ') + " are rejected")
+		expect(resumed == serial, "the same Pareto sets when the checkpoints with " + label.replace('_', ' ') + " are rejected")
+
+if fails:
+	exit(1)
+print("search_test: OK")
@@ -0,0 +1,134 @@
+/***
+    Checks the request server of biorseo --serve with a handler standing for the folds: an idle client must not hold
+    a worker, several clients are answered with a single worker, the answers to a client come in the order of its
+    requests, and a client closing its side after its requests still gets their answers.
+
+    make test
+***/
+
+#include "RequestServer.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+
+int connect_to(const string& socket_path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void send_text(int fd, const string& text) { send(fd, text.data(), text.size(), MSG_NOSIGNAL); }
+
+string receive(int fd, size_t n_answers, int timeout_ms = 5000)
+{
+    // What the server sent until n_answers answers (ending with an empty line) came back, or the timeout
+    string text;
+    auto   deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+    size_t found = 0;
+    for (size_t p = 0; found < n_answers;) {
+        int left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        if (left <= 0) break;
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, left) <= 0) break;
+        char    chunk[4096];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        text.append(chunk, n);
+        while ((p = text.find("\n\n", p)) != string::npos) {
+            p += 2;
+            found++;
+        }
+        p = text.size() > 1 ? text.size() - 1 : 0;
+    }
+    return text;
+}
+
+int main(void)
+{
+    int fails = 0;
+
+    auto expect = [&fails](bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << endl;
+            fails++;
+        }
+    };
+
+    char folder[] = "/tmp/biorseo_server_test_XXXXXX";
+    if (mkdtemp(folder) == nullptr) {
+        cerr << "FAILED: cannot create a temporary folder" << endl;
+        return EXIT_FAILURE;
+    }
+    string      socket_path = string(folder) + "/socket";
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path.c_str());
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0 or bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 or listen(server_fd, SOMAXCONN) < 0) {
+        cerr << "FAILED: cannot listen on " << socket_path << endl;
+        return EXIT_FAILURE;
+    }
+
+    // A single worker, which takes a while to answer
+    RequestServer server(server_fd, 1, [](const string& request, unsigned int worker) {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        return request + " by " + to_string(worker) + "\n\n";
+    });
+    thread serving(&RequestServer::run, &server);
+
+    int idle = connect_to(socket_path);
+    expect(idle >= 0, "an idle client connects");
+    send_text(idle, "half a req");    // and never ends its line
+
+    int active = connect_to(socket_path);
+    expect(active >= 0, "a second client connects");
+    send_text(active, "first\n");
+    expect(receive(active, 1) == "first by 0\n\n", "the second client is answered while the first one is idle");
+
+    send_text(active, "a\r\n\nb\nc\n");
+    expect(receive(active, 3) == "a by 0\n\nb by 0\n\nc by 0\n\n", "the answers come in the order of the requests");
+
+    int other = connect_to(socket_path);
+    expect(other >= 0, "a third client connects");
+    send_text(active, "x\ny\n");
+    send_text(other, "z\n");
+    string from_active = receive(active, 2), from_other = receive(other, 1);
+    expect(from_active == "x by 0\n\ny by 0\n\n" and from_other == "z by 0\n\n", "two clients sending requests at the same time are both answered");
+
+    int leaving = connect_to(socket_path);
+    send_text(leaving, "last\n");
+    shutdown(leaving, SHUT_WR);
+    expect(receive(leaving, 1) == "last by 0\n\n", "a client closing its side still gets its answers");
+    expect(receive(leaving, 1, 1000).empty(), "then the server closes the connection");
+
+    send_text(idle, "uest\n");
+    expect(receive(idle, 1) == "half a request by 0\n\n", "the idle client is answered when its request is complete");
+
+    server.stop();
+    serving.join();
+    for (int fd : { idle, active, other, leaving, server_fd }) close(fd);
+    unlink(socket_path.c_str());
+    rmdir(folder);
+
+    if (fails) return EXIT_FAILURE;
+    cout << "server_test: OK" << endl;
+    return EXIT_SUCCESS;
+}